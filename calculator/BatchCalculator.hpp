@@ -0,0 +1,108 @@
+#ifndef BATCH_CALCULATOR
+#define BATCH_CALCULATOR
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include "../thread_pool/thread_pool.hpp"
+#include "CompiledExpr.hpp"
+#include "InvalidExpr.hpp"
+#include "TokenArena.hpp"
+
+enum class ExprStatus : uint8_t {
+  kOk,
+  kInvalidExpr,  // Malformed, or it references variables.
+  // Any other exception: std::domain_error from an integer division by
+  // zero or one that overflows, std::bad_alloc.
+  kError,
+};
+
+// Expressions per task at least, so small batches are not split into
+// tasks cheaper than handing them out.
+const size_t kBatchCalculatorGrain = 256;
+
+// Evaluates many independent expressions at once. Each pool task takes a
+// contiguous block of them and parses all of it with one TokenArena. The
+// result and status of exprs[i] go to results[i] and statuses[i]; failed
+// expressions leave T() in results. Expressions are compiled without the
+// optimizer, which does not pay off for a single evaluation.
+template <typename T>
+class BatchCalculator {
+ public:
+  // Without a pool everything runs on the calling thread.
+  explicit BatchCalculator(ThreadPool* pool = nullptr) : pool_(pool) {}
+
+  // exprs is any random-access range of strings, such as
+  // std::vector<std::string> or std::span<const std::string_view>.
+  template <typename Exprs>
+    requires std::ranges::random_access_range<const Exprs> and
+             std::ranges::sized_range<const Exprs> and
+             std::convertible_to<
+                 std::ranges::range_reference_t<const Exprs>, std::string_view>
+  void CalculateExprs(const Exprs& exprs, std::span<T> results,
+                      std::span<ExprStatus> statuses) const;
+
+  // Returns the status and stores the value into result.
+  static ExprStatus CalculateExpr(std::string_view expr, TokenArena& arena,
+                                  T& result);
+
+ private:
+  ThreadPool* pool_;
+};
+
+template <typename T>
+ExprStatus BatchCalculator<T>::CalculateExpr(std::string_view expr,
+                                             TokenArena& arena, T& result) {
+  result = T();
+  try {
+    result = CompiledExpr<T>(expr, arena, false).Evaluate();
+  } catch (const InvalidExpr&) {
+    return ExprStatus::kInvalidExpr;
+  } catch (...) {
+    return ExprStatus::kError;
+  }
+  return ExprStatus::kOk;
+}
+
+template <typename T>
+template <typename Exprs>
+  requires std::ranges::random_access_range<const Exprs> and
+           std::ranges::sized_range<const Exprs> and
+           std::convertible_to<
+               std::ranges::range_reference_t<const Exprs>, std::string_view>
+void BatchCalculator<T>::CalculateExprs(
+    const Exprs& exprs, std::span<T> results,
+    std::span<ExprStatus> statuses) const {
+  size_t size = std::ranges::size(exprs);
+  if (results.size() != size or statuses.size() != size) {
+    throw std::invalid_argument("Output sizes do not match the input");
+  }
+  auto first = std::ranges::begin(exprs);
+  auto run = [&](size_t begin, size_t end) {
+    TokenArena arena;
+    for (size_t i = begin; i < end; ++i) {
+      statuses[i] =
+          CalculateExpr(std::string_view(first[i]), arena, results[i]);
+    }
+  };
+
+  size_t tasks = (size + kBatchCalculatorGrain - 1) / kBatchCalculatorGrain;
+  if (pool_ != nullptr) {
+    tasks = std::min(tasks, pool_->Size() * kThreadPoolTasksPerThread);
+  }
+  if (pool_ == nullptr or tasks <= 1) {
+    run(0, size);
+    return;
+  }
+  pool_->ParallelFor(tasks, [&](size_t task) {
+    run(size * task / tasks, size * (task + 1) / tasks);
+  });
+}
+
+#endif  // #ifndef BATCH_CALCULATOR
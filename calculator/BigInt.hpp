@@ -0,0 +1,625 @@
+#ifndef BIG_INT
+#define BIG_INT
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Routines over little-endian magnitudes of 64-bit limbs.
+namespace bigint_detail {
+
+using Limb = uint64_t;
+__extension__ typedef unsigned __int128 Wide;
+
+// Below this many limbs Karatsuba loses to the schoolbook product.
+constexpr size_t kKaratsubaThreshold = 48;
+
+inline int Compare(const Limb* lhs, size_t lhs_size, const Limb* rhs,
+                   size_t rhs_size) {
+  if (lhs_size != rhs_size) {
+    return lhs_size < rhs_size ? -1 : 1;
+  }
+  for (size_t i = lhs_size; i-- > 0;) {
+    if (lhs[i] != rhs[i]) {
+      return lhs[i] < rhs[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// dst[0, dst_size) += src[0, src_size), dst_size >= src_size. Returns the
+// carry out of dst.
+inline Limb AddInto(Limb* dst, size_t dst_size, const Limb* src,
+                    size_t src_size) {
+  Limb carry = 0;
+  size_t i = 0;
+  for (; i < src_size; ++i) {
+    Wide sum = Wide(dst[i]) + src[i] + carry;
+    dst[i] = Limb(sum);
+    carry = Limb(sum >> 64);
+  }
+  for (; carry != 0 and i < dst_size; ++i) {
+    carry = ++dst[i] == 0;
+  }
+  return carry;
+}
+
+// dst[0, dst_size) -= src[0, src_size), dst_size >= src_size. Returns the
+// borrow out of dst.
+inline Limb SubInto(Limb* dst, size_t dst_size, const Limb* src,
+                    size_t src_size) {
+  Limb borrow = 0;
+  size_t i = 0;
+  for (; i < src_size; ++i) {
+    Limb lhs = dst[i];
+    Limb diff = lhs - src[i] - borrow;
+    borrow = lhs < src[i] or (lhs == src[i] and borrow != 0);
+    dst[i] = diff;
+  }
+  for (; borrow != 0 and i < dst_size; ++i) {
+    borrow = dst[i]-- == 0;
+  }
+  return borrow;
+}
+
+// dst[0, lhs_size + rhs_size) = lhs * rhs.
+inline void MulSchoolbook(Limb* dst, const Limb* lhs, size_t lhs_size,
+                          const Limb* rhs, size_t rhs_size) {
+  std::fill(dst, dst + lhs_size + rhs_size, 0);
+  for (size_t i = 0; i < lhs_size; ++i) {
+    Limb carry = 0;
+    for (size_t j = 0; j < rhs_size; ++j) {
+      Wide product = Wide(lhs[i]) * rhs[j] + dst[i + j] + carry;
+      dst[i + j] = Limb(product);
+      carry = Limb(product >> 64);
+    }
+    dst[i + rhs_size] = carry;
+  }
+}
+
+// Limbs of scratch that Karatsuba needs for operands of size limbs.
+inline size_t KaratsubaScratch(size_t size) {
+  if (size < kKaratsubaThreshold) {
+    return 0;
+  }
+  size_t sum_size = size - size / 2 + 1;
+  return 4 * sum_size + KaratsubaScratch(sum_size);
+}
+
+// dst[0, 2 * size) = lhs * rhs, both of size limbs. With lhs = a1 B + a0
+// and rhs = b1 B + b0 the middle term a0 b1 + a1 b0 is computed as
+// (a0 + a1)(b0 + b1) - a0 b0 - a1 b1: three half-size products, not four.
+inline void MulKaratsuba(Limb* dst, const Limb* lhs, const Limb* rhs,
+                         size_t size, Limb* scratch) {
+  if (size < kKaratsubaThreshold) {
+    MulSchoolbook(dst, lhs, size, rhs, size);
+    return;
+  }
+  size_t low = size / 2;
+  size_t high = size - low;
+  size_t sum_size = high + 1;
+  MulKaratsuba(dst, lhs, rhs, low, scratch);
+  MulKaratsuba(dst + 2 * low, lhs + low, rhs + low, high, scratch);
+
+  Limb* lhs_sum = scratch;
+  Limb* rhs_sum = scratch + sum_size;
+  Limb* middle = scratch + 2 * sum_size;
+  std::copy(lhs + low, lhs + size, lhs_sum);
+  std::copy(rhs + low, rhs + size, rhs_sum);
+  lhs_sum[high] = AddInto(lhs_sum, high, lhs, low);
+  rhs_sum[high] = AddInto(rhs_sum, high, rhs, low);
+  MulKaratsuba(middle, lhs_sum, rhs_sum, sum_size, scratch + 4 * sum_size);
+  SubInto(middle, 2 * sum_size, dst, 2 * low);
+  SubInto(middle, 2 * sum_size, dst + 2 * low, 2 * high);
+
+  // The middle term is below 2 B^size, so it fits above low.
+  size_t middle_size = 2 * sum_size;
+  while (middle_size > 0 and middle[middle_size - 1] == 0) {
+    --middle_size;
+  }
+  AddInto(dst + low, 2 * size - low, middle, middle_size);
+}
+
+// dst[0, lhs_size + rhs_size) = lhs * rhs, lhs_size >= rhs_size > 0. An
+// unbalanced product is split into rhs_size blocks of lhs.
+inline void Mul(Limb* dst, const Limb* lhs, size_t lhs_size, const Limb* rhs,
+                size_t rhs_size) {
+  if (rhs_size < kKaratsubaThreshold) {
+    MulSchoolbook(dst, lhs, lhs_size, rhs, rhs_size);
+    return;
+  }
+  if (lhs_size == rhs_size) {
+    std::vector<Limb> scratch(KaratsubaScratch(rhs_size));
+    MulKaratsuba(dst, lhs, rhs, rhs_size, scratch.data());
+    return;
+  }
+  std::fill(dst, dst + lhs_size + rhs_size, 0);
+  std::vector<Limb> block(2 * rhs_size + KaratsubaScratch(rhs_size));
+  for (size_t offset = 0; offset < lhs_size; offset += rhs_size) {
+    size_t size = std::min(rhs_size, lhs_size - offset);
+    if (size == rhs_size) {
+      MulKaratsuba(block.data(), lhs + offset, rhs, size,
+                   block.data() + 2 * rhs_size);
+    } else {
+      Mul(block.data(), rhs, rhs_size, lhs + offset, size);
+    }
+    AddInto(dst + offset, lhs_size + rhs_size - offset, block.data(),
+            size + rhs_size);
+  }
+}
+
+// num[0, size) /= divisor. Returns the remainder.
+inline Limb DivSmall(Limb* num, size_t size, Limb divisor) {
+  Wide rem = 0;
+  for (size_t i = size; i-- > 0;) {
+    Wide cur = rem << 64 | num[i];
+    num[i] = Limb(cur / divisor);
+    rem = cur % divisor;
+  }
+  return Limb(rem);
+}
+
+// Knuth's algorithm D. quot gets num_size - div_size + 1 limbs and num is
+// replaced by the remainder. div_size >= 2 and the top limb of div is not
+// zero.
+inline void DivLarge(Limb* num, size_t num_size, const Limb* div,
+                     size_t div_size, Limb* quot) {
+  // Shift so that the top bit of the divisor is set; then every quotient
+  // digit estimate is off by at most two.
+  int shift = std::countl_zero(div[div_size - 1]);
+  std::vector<Limb> norm_div(div_size);
+  std::vector<Limb> rem(num_size + 1);
+  for (size_t i = div_size; i-- > 0;) {
+    norm_div[i] = div[i] << shift;
+    if (shift != 0 and i > 0) {
+      norm_div[i] |= div[i - 1] >> (64 - shift);
+    }
+  }
+  rem[num_size] = shift == 0 ? 0 : num[num_size - 1] >> (64 - shift);
+  for (size_t i = num_size; i-- > 0;) {
+    rem[i] = num[i] << shift;
+    if (shift != 0 and i > 0) {
+      rem[i] |= num[i - 1] >> (64 - shift);
+    }
+  }
+
+  Limb top = norm_div[div_size - 1];
+  Limb next = norm_div[div_size - 2];
+  for (size_t j = num_size - div_size + 1; j-- > 0;) {
+    Wide head = Wide(rem[j + div_size]) << 64 | rem[j + div_size - 1];
+    Wide digit = head / top;
+    Wide digit_rem = head % top;
+    while (digit >> 64 != 0 or
+           digit * next > (digit_rem << 64 | rem[j + div_size - 2])) {
+      --digit;
+      digit_rem += top;
+      if (digit_rem >> 64 != 0) {
+        break;
+      }
+    }
+
+    Limb carry = 0;
+    Limb borrow = 0;
+    for (size_t i = 0; i < div_size; ++i) {
+      Wide product = digit * norm_div[i] + carry;
+      carry = Limb(product >> 64);
+      Limb sub = Limb(product);
+      Limb cur = rem[i + j];
+      rem[i + j] = cur - sub - borrow;
+      borrow = cur < sub or (cur == sub and borrow != 0);
+    }
+    Limb cur = rem[j + div_size];
+    rem[j + div_size] = cur - carry - borrow;
+    borrow = cur < carry or (cur == carry and borrow != 0);
+    if (borrow != 0) {
+      --digit;
+      rem[j + div_size] +=
+          AddInto(rem.data() + j, div_size, norm_div.data(), div_size);
+    }
+    quot[j] = Limb(digit);
+  }
+
+  for (size_t i = 0; i < div_size; ++i) {
+    num[i] = rem[i] >> shift;
+    if (shift != 0) {
+      num[i] |= rem[i + 1] << (64 - shift);
+    }
+  }
+  std::fill(num + div_size, num + num_size, 0);
+}
+
+}  // namespace bigint_detail
+
+// Arbitrary-precision integer for Calculator<BigInt>. The magnitude is
+// kept in 64-bit limbs, and values of up to kInlineLimbs limbs are stored
+// in the object itself, so arithmetic on small numbers never allocates.
+// Division truncates toward zero, like the built-in integers; dividing by
+// zero throws std::domain_error.
+class BigInt {
+ public:
+  using Limb = bigint_detail::Limb;
+  static constexpr size_t kInlineLimbs = 2;
+
+  BigInt() = default;
+  template <std::integral Int>
+  BigInt(Int value);
+  // Decimal digits with an optional sign; throws std::invalid_argument.
+  explicit BigInt(std::string_view str);
+
+  BigInt(const BigInt& other) { Assign(other); }
+  BigInt(BigInt&& other) noexcept { Swap(other); }
+  BigInt& operator=(const BigInt& other) {
+    if (this != &other) {
+      Assign(other);
+    }
+    return *this;
+  }
+  BigInt& operator=(BigInt&& other) noexcept {
+    Swap(other);
+    return *this;
+  }
+  ~BigInt() { delete[] heap_; }
+
+  void Swap(BigInt& other) noexcept;
+
+  bool IsZero() const { return size_ == 0; }
+  bool IsNegative() const { return negative_; }
+  // Limbs of the magnitude.
+  size_t Size() const { return size_; }
+
+  BigInt& operator+=(const BigInt& rhs);
+  BigInt& operator-=(const BigInt& rhs);
+  BigInt& operator*=(const BigInt& rhs);
+  BigInt& operator/=(const BigInt& rhs);
+  BigInt& operator%=(const BigInt& rhs);
+
+  BigInt operator-() const {
+    BigInt res = *this;
+    res.negative_ = not res.IsZero() and not negative_;
+    return res;
+  }
+  BigInt operator+() const { return *this; }
+
+  friend bool operator==(const BigInt& lhs, const BigInt& rhs) {
+    return lhs.negative_ == rhs.negative_ and
+           bigint_detail::Compare(lhs.Data(), lhs.size_, rhs.Data(),
+                                  rhs.size_) == 0;
+  }
+  friend std::strong_ordering operator<=>(const BigInt& lhs,
+                                          const BigInt& rhs);
+
+  std::string ToString() const;
+
+  // Sets quot and rem, either of which may be null, to num / div and
+  // num % div.
+  static void DivMod(const BigInt& num, const BigInt& div, BigInt* quot,
+                     BigInt* rem);
+
+ private:
+  Limb* Data() { return heap_ != nullptr ? heap_ : inline_; }
+  const Limb* Data() const { return heap_ != nullptr ? heap_ : inline_; }
+
+  // Keeps the limbs below size and zero-fills the ones above.
+  void Resize(size_t size);
+  void Trim();
+  void Assign(const BigInt& other);
+
+  void AddMagnitude(const BigInt& rhs);
+  void SubMagnitude(const BigInt& rhs);
+  // *this = *this * mul + add, for non-negative *this.
+  void MulAddSmall(Limb mul, Limb add);
+
+  Limb* heap_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t capacity_ = kInlineLimbs;
+  bool negative_ = false;
+  Limb inline_[kInlineLimbs] = {};
+};
+
+template <std::integral Int>
+BigInt::BigInt(Int value) {
+  Limb magnitude = Limb(value);
+  if constexpr (std::is_signed_v<Int>) {
+    if (value < 0) {
+      negative_ = true;
+      magnitude = -magnitude;
+    }
+  }
+  inline_[0] = magnitude;
+  size_ = magnitude != 0;
+}
+
+inline BigInt::BigInt(std::string_view str) {
+  size_t pos = 0;
+  bool negative = false;
+  if (pos < str.size() and (str[pos] == '-' or str[pos] == '+')) {
+    negative = str[pos++] == '-';
+  }
+  if (pos == str.size()) {
+    throw std::invalid_argument("BigInt: no digits");
+  }
+  // 19 digits at a time: 10^19 is the largest power of ten in a limb.
+  while (pos < str.size()) {
+    size_t end = std::min(str.size(), pos + 19);
+    Limb chunk = 0;
+    Limb scale = 1;
+    for (; pos < end; ++pos) {
+      if (not std::isdigit(static_cast<unsigned char>(str[pos]))) {
+        throw std::invalid_argument("BigInt: not a digit");
+      }
+      chunk = chunk * 10 + (str[pos] - '0');
+      scale *= 10;
+    }
+    MulAddSmall(scale, chunk);
+  }
+  negative_ = negative and not IsZero();
+}
+
+inline void BigInt::Swap(BigInt& other) noexcept {
+  std::swap(heap_, other.heap_);
+  std::swap(size_, other.size_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(negative_, other.negative_);
+  std::swap(inline_, other.inline_);
+}
+
+inline void BigInt::Resize(size_t size) {
+  if (size > capacity_) {
+    size_t capacity = std::max<size_t>(size, 2 * capacity_);
+    Limb* heap = new Limb[capacity];
+    std::copy(Data(), Data() + size_, heap);
+    delete[] heap_;
+    heap_ = heap;
+    capacity_ = capacity;
+  }
+  if (size > size_) {
+    std::fill(Data() + size_, Data() + size, 0);
+  }
+  size_ = size;
+}
+
+inline void BigInt::Trim() {
+  const Limb* data = Data();
+  while (size_ > 0 and data[size_ - 1] == 0) {
+    --size_;
+  }
+  if (size_ == 0) {
+    negative_ = false;
+  }
+}
+
+inline void BigInt::Assign(const BigInt& other) {
+  size_ = 0;
+  Resize(other.size_);
+  std::copy(other.Data(), other.Data() + other.size_, Data());
+  negative_ = other.negative_;
+}
+
+inline void BigInt::AddMagnitude(const BigInt& rhs) {
+  size_t size = std::max(size_, rhs.size_);
+  Resize(size + 1);
+  bigint_detail::AddInto(Data(), size + 1, rhs.Data(), rhs.size_);
+  Trim();
+}
+
+inline void BigInt::SubMagnitude(const BigInt& rhs) {
+  int cmp = bigint_detail::Compare(Data(), size_, rhs.Data(), rhs.size_);
+  if (cmp >= 0) {
+    bigint_detail::SubInto(Data(), size_, rhs.Data(), rhs.size_);
+  } else {
+    // |rhs| - |this|, computed in place.
+    Resize(rhs.size_);
+    Limb* data = Data();
+    const Limb* other = rhs.Data();
+    Limb borrow = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      Limb cur = data[i];
+      data[i] = other[i] - cur - borrow;
+      borrow = other[i] < cur or (other[i] == cur and borrow != 0);
+    }
+    negative_ = not negative_;
+  }
+  Trim();
+}
+
+inline void BigInt::MulAddSmall(Limb mul, Limb add) {
+  Limb* data = Data();
+  Limb carry = add;
+  for (size_t i = 0; i < size_; ++i) {
+    bigint_detail::Wide cur = bigint_detail::Wide(data[i]) * mul + carry;
+    data[i] = Limb(cur);
+    carry = Limb(cur >> 64);
+  }
+  if (carry != 0) {
+    Resize(size_ + 1);
+    Data()[size_ - 1] = carry;
+  }
+}
+
+inline BigInt& BigInt::operator+=(const BigInt& rhs) {
+  if (this == &rhs) {
+    return *this += BigInt(rhs);
+  }
+  if (negative_ == rhs.negative_) {
+    AddMagnitude(rhs);
+  } else {
+    SubMagnitude(rhs);
+  }
+  return *this;
+}
+
+inline BigInt& BigInt::operator-=(const BigInt& rhs) {
+  if (this == &rhs) {
+    return *this = BigInt();
+  }
+  if (negative_ != rhs.negative_) {
+    AddMagnitude(rhs);
+  } else {
+    SubMagnitude(rhs);
+  }
+  return *this;
+}
+
+inline BigInt& BigInt::operator*=(const BigInt& rhs) {
+  bool negative = negative_ != rhs.negative_;
+  if (IsZero() or rhs.IsZero()) {
+    return *this = BigInt();
+  }
+  if (size_ == 1 and rhs.size_ == 1) {
+    bigint_detail::Wide product =
+        bigint_detail::Wide(Data()[0]) * rhs.Data()[0];
+    Data()[0] = Limb(product);
+    Resize(2);
+    Data()[1] = Limb(product >> 64);
+  } else {
+    const BigInt& lhs = size_ >= rhs.size_ ? *this : rhs;
+    const BigInt& small = size_ >= rhs.size_ ? rhs : *this;
+    BigInt res;
+    res.Resize(size_ + rhs.size_);
+    bigint_detail::Mul(res.Data(), lhs.Data(), lhs.size_, small.Data(),
+                       small.size_);
+    Swap(res);
+  }
+  negative_ = negative;
+  Trim();
+  return *this;
+}
+
+inline void BigInt::DivMod(const BigInt& num, const BigInt& div,
+                           BigInt* quot, BigInt* rem) {
+  if (div.IsZero()) {
+    throw std::domain_error("BigInt: division by zero");
+  }
+  bool quot_negative = num.negative_ != div.negative_;
+  bool rem_negative = num.negative_;
+  if (bigint_detail::Compare(num.Data(), num.size_, div.Data(),
+                             div.size_) < 0) {
+    if (rem != nullptr) {
+      *rem = num;
+    }
+    if (quot != nullptr) {
+      *quot = BigInt();
+    }
+    return;
+  }
+
+  BigInt res_rem = num;
+  BigInt res_quot;
+  res_quot.Resize(num.size_ - div.size_ + 1);
+  if (div.size_ == 1) {
+    std::copy(num.Data(), num.Data() + num.size_, res_quot.Data());
+    res_rem = BigInt(bigint_detail::DivSmall(res_quot.Data(), num.size_,
+                                             div.Data()[0]));
+  } else {
+    bigint_detail::DivLarge(res_rem.Data(), res_rem.size_, div.Data(),
+                            div.size_, res_quot.Data());
+  }
+  res_quot.negative_ = quot_negative;
+  res_quot.Trim();
+  res_rem.negative_ = rem_negative;
+  res_rem.Trim();
+  if (quot != nullptr) {
+    quot->Swap(res_quot);
+  }
+  if (rem != nullptr) {
+    rem->Swap(res_rem);
+  }
+}
+
+inline BigInt& BigInt::operator/=(const BigInt& rhs) {
+  DivMod(*this, rhs, this, nullptr);
+  return *this;
+}
+
+inline BigInt& BigInt::operator%=(const BigInt& rhs) {
+  DivMod(*this, rhs, nullptr, this);
+  return *this;
+}
+
+inline std::strong_ordering operator<=>(const BigInt& lhs,
+                                        const BigInt& rhs) {
+  if (lhs.negative_ != rhs.negative_) {
+    return lhs.negative_ ? std::strong_ordering::less
+                         : std::strong_ordering::greater;
+  }
+  int cmp =
+      bigint_detail::Compare(lhs.Data(), lhs.size_, rhs.Data(), rhs.size_);
+  if (lhs.negative_) {
+    cmp = -cmp;
+  }
+  return cmp <=> 0;
+}
+
+inline std::string BigInt::ToString() const {
+  if (IsZero()) {
+    return "0";
+  }
+  const Limb kChunk = 10'000'000'000'000'000'000u;
+  std::vector<Limb> num(Data(), Data() + size_);
+  std::vector<Limb> chunks;
+  size_t size = num.size();
+  while (size > 0) {
+    chunks.push_back(bigint_detail::DivSmall(num.data(), size, kChunk));
+    while (size > 0 and num[size - 1] == 0) {
+      --size;
+    }
+  }
+
+  std::string res = negative_ ? "-" : "";
+  res += std::to_string(chunks.back());
+  for (size_t i = chunks.size() - 1; i-- > 0;) {
+    std::string chunk = std::to_string(chunks[i]);
+    res.append(19 - chunk.size(), '0');
+    res += chunk;
+  }
+  return res;
+}
+
+inline BigInt operator+(BigInt lhs, const BigInt& rhs) { return lhs += rhs; }
+inline BigInt operator-(BigInt lhs, const BigInt& rhs) { return lhs -= rhs; }
+inline BigInt operator*(BigInt lhs, const BigInt& rhs) { return lhs *= rhs; }
+inline BigInt operator/(BigInt lhs, const BigInt& rhs) { return lhs /= rhs; }
+inline BigInt operator%(BigInt lhs, const BigInt& rhs) { return lhs %= rhs; }
+
+// Found by argument-dependent lookup, next to std::to_string.
+inline std::string to_string(const BigInt& value) { return value.ToString(); }
+
+inline std::ostream& operator<<(std::ostream& out, const BigInt& value) {
+  return out << value.ToString();
+}
+
+// Reads an optional sign and the digits after it.
+inline std::istream& operator>>(std::istream& in, BigInt& value) {
+  std::istream::sentry sentry(in);
+  if (not sentry) {
+    return in;
+  }
+  std::string str;
+  if (in.peek() == '-' or in.peek() == '+') {
+    str += static_cast<char>(in.get());
+  }
+  while (std::isdigit(in.peek())) {
+    str += static_cast<char>(in.get());
+  }
+  if (str.empty() or str.back() == '-' or str.back() == '+') {
+    in.setstate(std::ios::failbit);
+    return in;
+  }
+  value = BigInt(str);
+  return in;
+}
+
+#endif  // #ifndef BIG_INT
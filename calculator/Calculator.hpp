@@ -1,73 +1,46 @@
 #ifndef CALCULATOR
 #define CALCULATOR
 
-#include "ExprInPolishNotation.hpp"
+#include <string>
+
+#include "CompiledExpr.hpp"
+#include "ExprJit.hpp"
 
 template <typename T>
 class Calculator {
  public:
+  // strexpr may not reference variables; compile it to supply them.
   static T CalculateExpr(const std::string& strexpr);
-
- private:
-  static void CalculateLastToken(std::stack<AbstractToken*>& tokens);
-  static AbstractToken* ExtractLastToken(std::stack<AbstractToken*>& tokens);
+  // Takes the compiled form from cache (an ExprCache or ShardedExprCache),
+  // so a repeated strexpr is parsed only once.
+  template <typename Cache>
+  static T CalculateExpr(const std::string& strexpr, Cache& cache);
+
+  // Parses strexpr once; evaluate the result as many times as needed.
+  static CompiledExpr<T> Compile(const std::string& strexpr);
+  // Like Compile, but translated to machine code where JitExpr supports it.
+  static JitExpr<T> CompileNative(const std::string& strexpr);
 };
 
 template <typename T>
 T Calculator<T>::CalculateExpr(const std::string& strexpr) {
-  ExprInPolishNotation<T> polexpr(strexpr);
-
-  std::stack<AbstractToken*> tokens;
-  try {
-    tokens = polexpr.GetTokens();
-  } catch (InvalidExpr exc) {
-    throw exc;
-  }
-
-  while (tokens.size() != 1) {
-    CalculateLastToken(tokens);
-  }
-
-  auto* last_token = static_cast<OperandToken<T>*>(tokens.top());
-  T res = last_token->GetValue();
-  delete last_token;
-  return res;
+  return Compile(strexpr).Evaluate();
 }
 
 template <typename T>
-void Calculator<T>::CalculateLastToken(std::stack<AbstractToken*>& tokens) {
-  auto* token = tokens.top();
-  tokens.pop();
-  if (typeid(*token) == typeid(UnaryOperatorToken<T>)) {
-    auto* opr = static_cast<UnaryOperatorToken<T>*>(token);
-    auto* operand = static_cast<OperandToken<T>*>(ExtractLastToken(tokens));
-
-    tokens.push(opr->Calculate(operand));
-
-    delete opr;
-    delete operand;
-  } else if (typeid(*token) == typeid(BinaryOperatorToken<T>)) {
-    auto* opr = static_cast<BinaryOperatorToken<T>*>(token);
-    auto* lhs = static_cast<OperandToken<T>*>(ExtractLastToken(tokens));
-    auto* rhs = static_cast<OperandToken<T>*>(ExtractLastToken(tokens));
-
-    tokens.push(opr->Calculate(rhs, lhs));
+template <typename Cache>
+T Calculator<T>::CalculateExpr(const std::string& strexpr, Cache& cache) {
+  return cache.Get(strexpr)->Evaluate();
+}
 
-    delete opr;
-    delete lhs;
-    delete rhs;
-  } else if (typeid(*token) == typeid(OperandToken<T>)) {
-    tokens.push(token);
-  }
+template <typename T>
+CompiledExpr<T> Calculator<T>::Compile(const std::string& strexpr) {
+  return CompiledExpr<T>(strexpr);
 }
 
 template <typename T>
-AbstractToken* Calculator<T>::ExtractLastToken(
-    std::stack<AbstractToken*>& tokens) {
-  CalculateLastToken(tokens);
-  AbstractToken* res = tokens.top();
-  tokens.pop();
-  return res;
+JitExpr<T> Calculator<T>::CompileNative(const std::string& strexpr) {
+  return JitExpr<T>(strexpr);
 }
 
 #endif  // #ifndef CALCULATOR
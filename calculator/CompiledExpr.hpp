@@ -0,0 +1,349 @@
+#ifndef COMPILED_EXPR
+#define COMPILED_EXPR
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AbstractToken.hpp"
+#include "ExprInPolishNotation.hpp"
+#include "ExprOptimizer.hpp"
+#include "InvalidExpr.hpp"
+#include "OpCode.hpp"
+#include "OperandToken.hpp"
+#include "OperatorToken.hpp"
+#include "TokenArena.hpp"
+#include "VariableToken.hpp"
+
+// An expression compiled once into a flat program for a stack machine,
+// one byte per instruction (see OpCode). Unless disabled, the program is
+// run through ExprOptimizer. Evaluation allocates nothing as long as the
+// stack and the temporaries fit into kInlineStack values.
+//
+// Variables are numbered in order of first appearance; Variables() lists
+// their names, and values are always passed in that order.
+template <typename T>
+class CompiledExpr {
+ public:
+  static const size_t kInlineStack = 64;
+  // Rows per pass of a column evaluation: one stack level of every row of
+  // a chunk is a contiguous array, so each instruction is one tight loop.
+  static constexpr size_t kColumnChunk = 256;
+
+  explicit CompiledExpr(std::string_view expr, bool optimize = true);
+  // Parses with the tokens in arena, which is reset before returning, so
+  // one arena can serve any number of expressions.
+  CompiledExpr(std::string_view expr, TokenArena& arena,
+               bool optimize = true);
+
+  T Evaluate() const { return Evaluate(nullptr); }
+  T Evaluate(const T* values) const;
+
+  // out[row] = value of the expression at columns[0][row], columns[1][row],
+  // ... for every row below rows.
+  void Evaluate(size_t rows, const T* const* columns, T* out) const;
+  template <typename... Columns>
+  std::vector<T> Evaluate(const std::vector<T>& column,
+                          const Columns&... columns) const;
+
+  const std::vector<std::string>& Variables() const { return variables_; }
+  const std::vector<OpCode>& Code() const { return code_; }
+  const std::vector<T>& Constants() const { return constants_; }
+  const std::vector<uint32_t>& Slots() const { return slots_; }
+  size_t MaxDepth() const { return max_depth_; }
+  size_t Temps() const { return temps_; }
+
+ private:
+  void Parse(std::string_view expr, TokenArena& arena);
+  void Compile(const std::vector<AbstractToken*>& tokens);
+  void Emit(OpCode op, size_t pops);
+  void Optimize();
+  uint32_t Slot(const std::string& name);
+  T Run(T* stack, const T* values) const;
+  void RunChunk(size_t begin, size_t size, const T* const* columns,
+                T* scratch, const T** levels, T* out) const;
+
+  std::vector<OpCode> code_;
+  std::vector<T> constants_;
+  std::vector<uint32_t> slots_;
+  std::vector<std::string> variables_;
+  size_t depth_ = 0;
+  size_t max_depth_ = 0;
+  size_t temps_ = 0;
+};
+
+template <typename T>
+CompiledExpr<T>::CompiledExpr(std::string_view expr, bool optimize) {
+  TokenArena arena;
+  Parse(expr, arena);
+  if (optimize) {
+    Optimize();
+  }
+}
+
+template <typename T>
+CompiledExpr<T>::CompiledExpr(std::string_view expr, TokenArena& arena,
+                              bool optimize) {
+  try {
+    Parse(expr, arena);
+  } catch (...) {
+    arena.Reset();
+    throw;
+  }
+  arena.Reset();
+  if (optimize) {
+    Optimize();
+  }
+}
+
+template <typename T>
+void CompiledExpr<T>::Parse(std::string_view expr, TokenArena& arena) {
+  ExprInPolishNotation<T> parsed(expr, &arena);
+  std::stack<AbstractToken*> stack = parsed.GetTokens();
+  std::vector<AbstractToken*> tokens(stack.size());
+  for (size_t i = tokens.size(); i-- > 0;) {
+    tokens[i] = stack.top();
+    stack.pop();
+  }
+  Compile(tokens);
+}
+
+template <typename T>
+void CompiledExpr<T>::Emit(OpCode op, size_t pops) {
+  assert(depth_ >= pops);
+  depth_ -= pops;
+  code_.push_back(op);
+  ++depth_;
+  max_depth_ = depth_ > max_depth_ ? depth_ : max_depth_;
+}
+
+// tokens are in reverse Polish order, bottom of the parser stack first.
+// ExprInPolishNotation only produces well-formed expressions, so the stack
+// never underflows here.
+template <typename T>
+void CompiledExpr<T>::Compile(const std::vector<AbstractToken*>& tokens) {
+  code_.reserve(tokens.size());
+  for (AbstractToken* token : tokens) {
+    if (auto* operand = dynamic_cast<OperandToken<T>*>(token)) {
+      constants_.push_back(operand->GetValue());
+      Emit(OpCode::kPush, 0);
+      continue;
+    }
+    if (dynamic_cast<VariableToken*>(token) != nullptr) {
+      slots_.push_back(Slot(token->GetStringToken()));
+      Emit(OpCode::kLoad, 0);
+      continue;
+    }
+    char opr = token->GetStringToken()[0];
+    if (dynamic_cast<UnaryOperatorToken<T>*>(token) != nullptr) {
+      assert(depth_ != 0 and (opr == '-' or opr == '+'));
+      if (opr == '-') {
+        Emit(OpCode::kNeg, 1);
+      }
+      continue;
+    }
+    switch (opr) {
+      case '+':
+        Emit(OpCode::kAdd, 2);
+        break;
+      case '-':
+        Emit(OpCode::kSub, 2);
+        break;
+      case '*':
+        Emit(OpCode::kMul, 2);
+        break;
+      case '/':
+        Emit(OpCode::kDiv, 2);
+        break;
+    }
+  }
+  assert(depth_ == 1);
+}
+
+template <typename T>
+void CompiledExpr<T>::Optimize() {
+  ExprOptimizer<T> optimizer(code_, constants_, slots_);
+  code_.clear();
+  constants_.clear();
+  slots_.clear();
+  temps_ = optimizer.Emit(code_, constants_, slots_);
+  depth_ = 0;
+  max_depth_ = 0;
+  for (OpCode op : code_) {
+    depth_ += StackEffect(op);
+    max_depth_ = depth_ > max_depth_ ? depth_ : max_depth_;
+  }
+}
+
+template <typename T>
+uint32_t CompiledExpr<T>::Slot(const std::string& name) {
+  auto found = std::find(variables_.begin(), variables_.end(), name);
+  if (found == variables_.end()) {
+    variables_.push_back(name);
+    return variables_.size() - 1;
+  }
+  return found - variables_.begin();
+}
+
+template <typename T>
+T CompiledExpr<T>::Evaluate(const T* values) const {
+  if (values == nullptr and not variables_.empty()) {
+    throw InvalidExpr("unbound variable " + variables_[0]);
+  }
+  if (max_depth_ + temps_ <= kInlineStack) {
+    T stack[kInlineStack];
+    return Run(stack, values);
+  }
+  std::vector<T> stack(max_depth_ + temps_);
+  return Run(stack.data(), values);
+}
+
+// Temporaries live in stack right above the deepest level.
+template <typename T>
+T CompiledExpr<T>::Run(T* stack, const T* values) const {
+  T* top = stack;
+  T* temps = stack + max_depth_;
+  const T* constant = constants_.data();
+  const uint32_t* slot = slots_.data();
+  for (OpCode op : code_) {
+    switch (op) {
+      case OpCode::kPush:
+        *top++ = *constant++;
+        break;
+      case OpCode::kLoad:
+        *top++ = values[*slot++];
+        break;
+      case OpCode::kStore:
+        temps[*slot++] = top[-1];
+        break;
+      case OpCode::kRecall:
+        *top++ = temps[*slot++];
+        break;
+      case OpCode::kNeg:
+        top[-1] = -top[-1];
+        break;
+      case OpCode::kAdd:
+        --top;
+        top[-1] = top[-1] + top[0];
+        break;
+      case OpCode::kSub:
+        --top;
+        top[-1] = top[-1] - top[0];
+        break;
+      case OpCode::kMul:
+        --top;
+        top[-1] = top[-1] * top[0];
+        break;
+      case OpCode::kDiv:
+        --top;
+        top[-1] = Divide(top[-1], top[0]);
+        break;
+    }
+  }
+  return stack[0];
+}
+
+template <typename T>
+void CompiledExpr<T>::Evaluate(size_t rows, const T* const* columns,
+                               T* out) const {
+  std::vector<T> scratch((max_depth_ + temps_) * kColumnChunk);
+  std::vector<const T*> levels(max_depth_);
+  for (size_t begin = 0; begin < rows; begin += kColumnChunk) {
+    RunChunk(begin, std::min(kColumnChunk, rows - begin), columns,
+             scratch.data(), levels.data(), out);
+  }
+}
+
+template <typename T>
+template <typename... Columns>
+std::vector<T> CompiledExpr<T>::Evaluate(const std::vector<T>& column,
+                                         const Columns&... columns) const {
+  const T* pointers[] = {column.data(), columns.data()...};
+  if (sizeof...(Columns) + 1 != variables_.size() or
+      ((columns.size() != column.size()) or ...)) {
+    throw std::invalid_argument("Columns do not match the variables");
+  }
+  std::vector<T> res(column.size());
+  Evaluate(res.size(), pointers, res.data());
+  return res;
+}
+
+// levels[d] is where stack level d of the chunk is read from: a constant
+// broadcast into scratch, a result in scratch, or a variable read straight
+// from its column. Results always go to the scratch row of their level;
+// the rows past max_depth_ hold temporaries.
+template <typename T>
+void CompiledExpr<T>::RunChunk(size_t begin, size_t size,
+                               const T* const* columns, T* scratch,
+                               const T** levels, T* out) const {
+  const T* constant = constants_.data();
+  const uint32_t* slot = slots_.data();
+  size_t top = 0;
+  for (OpCode op : code_) {
+    if (op == OpCode::kPush) {
+      T* dst = scratch + top * kColumnChunk;
+      std::fill(dst, dst + size, *constant++);
+      levels[top++] = dst;
+      continue;
+    }
+    if (op == OpCode::kLoad) {
+      levels[top++] = columns[*slot++] + begin;
+      continue;
+    }
+    if (op == OpCode::kStore or op == OpCode::kRecall) {
+      T* temp = scratch + (max_depth_ + *slot++) * kColumnChunk;
+      if (op == OpCode::kStore) {
+        std::copy(levels[top - 1], levels[top - 1] + size, temp);
+        levels[top - 1] = temp;
+      } else {
+        levels[top++] = temp;
+      }
+      continue;
+    }
+    const T* rhs = levels[top - 1];
+    if (op != OpCode::kNeg) {
+      --top;
+    }
+    const T* lhs = levels[top - 1];
+    T* dst = scratch + (top - 1) * kColumnChunk;
+    switch (op) {
+      case OpCode::kNeg:
+        for (size_t i = 0; i < size; ++i) {
+          dst[i] = -rhs[i];
+        }
+        break;
+      case OpCode::kAdd:
+        for (size_t i = 0; i < size; ++i) {
+          dst[i] = lhs[i] + rhs[i];
+        }
+        break;
+      case OpCode::kSub:
+        for (size_t i = 0; i < size; ++i) {
+          dst[i] = lhs[i] - rhs[i];
+        }
+        break;
+      case OpCode::kMul:
+        for (size_t i = 0; i < size; ++i) {
+          dst[i] = lhs[i] * rhs[i];
+        }
+        break;
+      case OpCode::kDiv:
+        for (size_t i = 0; i < size; ++i) {
+          dst[i] = Divide(lhs[i], rhs[i]);
+        }
+        break;
+      default:
+        break;
+    }
+    levels[top - 1] = dst;
+  }
+  std::copy(levels[0], levels[0] + size, out + begin);
+}
+
+#endif  // #ifndef COMPILED_EXPR
@@ -0,0 +1,198 @@
+#ifndef EXPR_CACHE
+#define EXPR_CACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CompiledExpr.hpp"
+
+struct ExprCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+
+  ExprCacheStats& operator+=(const ExprCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    return *this;
+  }
+};
+
+// Bounded map from expression text to its compiled form, evicting the
+// least recently used entry. Safe to share between threads: lookups take
+// one lock, compilation runs outside of it. Entries are handed out as
+// shared pointers and stay valid after eviction. Invalid expressions are
+// not cached; Get rethrows InvalidExpr every time.
+template <typename T>
+class ExprCache {
+ public:
+  using Entry = std::shared_ptr<const CompiledExpr<T>>;
+
+  explicit ExprCache(size_t capacity) : capacity_(capacity) {}
+  ExprCache(const ExprCache&) = delete;
+  ExprCache& operator=(const ExprCache&) = delete;
+
+  Entry Get(std::string_view expr);
+  T CalculateExpr(std::string_view expr) { return Get(expr)->Evaluate(); }
+
+  size_t Size() const;
+  size_t Capacity() const { return capacity_; }
+  ExprCacheStats Stats() const;
+  void Clear();
+
+ private:
+  using List = std::list<std::pair<std::string, Entry>>;
+
+  bool Find(std::string_view expr, Entry& entry);
+
+  size_t capacity_;
+  mutable std::mutex mutex_;
+  List entries_;  // Most recently used first.
+  // Keys view the strings in entries_, whose nodes never move.
+  std::unordered_map<std::string_view, typename List::iterator> index_;
+  ExprCacheStats stats_;
+};
+
+template <typename T>
+bool ExprCache<T>::Find(std::string_view expr, Entry& entry) {
+  auto found = index_.find(expr);
+  if (found == index_.end()) {
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, found->second);
+  entry = found->second->second;
+  return true;
+}
+
+template <typename T>
+typename ExprCache<T>::Entry ExprCache<T>::Get(std::string_view expr) {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (Find(expr, entry)) {
+      ++stats_.hits;
+      return entry;
+    }
+    ++stats_.misses;
+  }
+  entry = std::make_shared<const CompiledExpr<T>>(expr);
+  if (capacity_ == 0) {
+    return entry;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another thread may have compiled the same text meanwhile.
+  Entry existing;
+  if (Find(expr, existing)) {
+    return existing;
+  }
+  if (entries_.size() == capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+    ++stats_.evictions;
+  }
+  entries_.emplace_front(std::string(expr), entry);
+  index_.emplace(entries_.front().first, entries_.begin());
+  return entry;
+}
+
+template <typename T>
+size_t ExprCache<T>::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+template <typename T>
+ExprCacheStats ExprCache<T>::Stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+template <typename T>
+void ExprCache<T>::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.clear();
+  entries_.clear();
+}
+
+// ExprCache split into independent shards picked by the hash of the text,
+// so threads looking up different expressions rarely share a lock. Each
+// shard is an LRU of its own; the total capacity is divided evenly.
+template <typename T>
+class ShardedExprCache {
+ public:
+  using Entry = typename ExprCache<T>::Entry;
+  static const size_t kDefaultShards = 16;
+
+  explicit ShardedExprCache(size_t capacity, size_t shards = kDefaultShards);
+
+  Entry Get(std::string_view expr) { return Shard(expr).Get(expr); }
+  T CalculateExpr(std::string_view expr) { return Get(expr)->Evaluate(); }
+
+  size_t Size() const;
+  size_t Capacity() const;
+  ExprCacheStats Stats() const;
+  void Clear();
+
+ private:
+  ExprCache<T>& Shard(std::string_view expr) {
+    return *shards_[std::hash<std::string_view>()(expr) % shards_.size()];
+  }
+
+  std::vector<std::unique_ptr<ExprCache<T>>> shards_;
+};
+
+template <typename T>
+ShardedExprCache<T>::ShardedExprCache(size_t capacity, size_t shards) {
+  shards = shards == 0 ? 1 : shards;
+  for (size_t i = 0; i < shards; ++i) {
+    shards_.push_back(std::make_unique<ExprCache<T>>(
+        capacity / shards + (i < capacity % shards ? 1 : 0)));
+  }
+}
+
+template <typename T>
+size_t ShardedExprCache<T>::Size() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    size += shard->Size();
+  }
+  return size;
+}
+
+template <typename T>
+size_t ShardedExprCache<T>::Capacity() const {
+  size_t capacity = 0;
+  for (const auto& shard : shards_) {
+    capacity += shard->Capacity();
+  }
+  return capacity;
+}
+
+template <typename T>
+ExprCacheStats ShardedExprCache<T>::Stats() const {
+  ExprCacheStats stats;
+  for (const auto& shard : shards_) {
+    stats += shard->Stats();
+  }
+  return stats;
+}
+
+template <typename T>
+void ShardedExprCache<T>::Clear() {
+  for (const auto& shard : shards_) {
+    shard->Clear();
+  }
+}
+
+#endif  // #ifndef EXPR_CACHE
@@ -0,0 +1,309 @@
+#ifndef EXPR_GRAPH
+#define EXPR_GRAPH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CompiledExpr.hpp"
+#include "TokenArena.hpp"
+
+// Named inputs and formulas over them, kept up to date incrementally. A
+// formula is a compiled expression whose variables name inputs or other
+// formulas. Changing an input marks the formulas that read it; Update()
+// recomputes only those, level by level in topological order, and goes
+// further only from formulas whose value actually changed. The work per
+// change is proportional to the part of the graph it reaches.
+//
+// A name that is referenced before it is defined becomes an input without
+// a value. Formulas depending on a name without a value have none either.
+template <typename T>
+class ExprGraph {
+ public:
+  // Sets the input name, creating it if needed. Throws
+  // std::invalid_argument if name is a formula.
+  void SetInput(const std::string& name, const T& value);
+  // Defines name as expr, or replaces its definition; an input becomes a
+  // formula. Throws InvalidExpr for a malformed expression and
+  // std::invalid_argument for a cyclic dependency, leaving the graph as
+  // it was in both cases.
+  void Define(const std::string& name, std::string_view expr,
+              bool optimize = true);
+
+  // Recomputes the formulas affected by changes since the last update.
+  // Returns how many were evaluated. If an evaluation throws, the rest
+  // stays pending for the next call.
+  size_t Update();
+
+  // Updates and returns the value of name. Throws std::out_of_range if
+  // there is no such name or it has no value.
+  const T& Get(const std::string& name);
+
+  bool Contains(const std::string& name) const {
+    return names_.count(name) != 0;
+  }
+  size_t Size() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    std::string name;
+    std::optional<CompiledExpr<T>> expr;  // Empty for inputs.
+    std::vector<uint32_t> deps;  // In the order of expr->Variables().
+    std::vector<uint32_t> dependents;
+    T value = T();
+    // 0 for inputs, otherwise one more than the deepest dependency.
+    uint32_t level = 0;
+    bool has_value = false;
+    bool dirty = false;
+  };
+
+  uint32_t Id(const std::string& name);
+  void Mark(uint32_t id);
+  void MarkDependents(uint32_t id);
+  // Returns whether the value of the formula changed.
+  bool Recompute(Node& node);
+  // Nodes reachable from id through dependents, id first.
+  std::vector<uint32_t> Downstream(uint32_t id) const;
+  void Relevel(const std::vector<uint32_t>& nodes);
+
+  std::vector<Node> nodes_;
+  std::unordered_map<std::string, uint32_t> names_;
+  // Dirty formulas by level.
+  std::vector<std::vector<uint32_t>> dirty_;
+  size_t dirty_count_ = 0;
+  std::vector<T> args_;
+  TokenArena arena_;
+};
+
+template <typename T>
+uint32_t ExprGraph<T>::Id(const std::string& name) {
+  auto [it, inserted] = names_.emplace(name, nodes_.size());
+  if (inserted) {
+    nodes_.emplace_back();
+    nodes_.back().name = name;
+  }
+  return it->second;
+}
+
+template <typename T>
+void ExprGraph<T>::Mark(uint32_t id) {
+  Node& node = nodes_[id];
+  if (node.dirty) {
+    return;
+  }
+  node.dirty = true;
+  if (dirty_.size() <= node.level) {
+    dirty_.resize(node.level + 1);
+  }
+  dirty_[node.level].push_back(id);
+  ++dirty_count_;
+}
+
+template <typename T>
+void ExprGraph<T>::MarkDependents(uint32_t id) {
+  for (uint32_t dependent : nodes_[id].dependents) {
+    Mark(dependent);
+  }
+}
+
+template <typename T>
+void ExprGraph<T>::SetInput(const std::string& name, const T& value) {
+  uint32_t id = Id(name);
+  Node& node = nodes_[id];
+  if (node.expr) {
+    throw std::invalid_argument("ExprGraph: " + name + " is a formula");
+  }
+  if (node.has_value and node.value == value) {
+    return;
+  }
+  node.value = value;
+  node.has_value = true;
+  MarkDependents(id);
+}
+
+template <typename T>
+void ExprGraph<T>::Define(const std::string& name, std::string_view expr,
+                          bool optimize) {
+  CompiledExpr<T> compiled(expr, arena_, optimize);
+  // Everything downstream of name would end up depending on itself.
+  auto found = names_.find(name);
+  std::vector<uint32_t> downstream;
+  std::vector<bool> is_downstream(nodes_.size());
+  if (found != names_.end()) {
+    downstream = Downstream(found->second);
+    for (uint32_t id : downstream) {
+      is_downstream[id] = true;
+    }
+  }
+  for (const std::string& var : compiled.Variables()) {
+    auto dep = names_.find(var);
+    if (var == name or (dep != names_.end() and is_downstream[dep->second])) {
+      throw std::invalid_argument("ExprGraph: " + name +
+                                  " would depend on itself");
+    }
+  }
+
+  uint32_t id = Id(name);
+  if (downstream.empty()) {
+    downstream.push_back(id);
+  }
+  for (uint32_t dep : nodes_[id].deps) {
+    std::vector<uint32_t>& list = nodes_[dep].dependents;
+    list.erase(std::find(list.begin(), list.end(), id));
+  }
+  std::vector<uint32_t> deps;
+  for (const std::string& var : compiled.Variables()) {
+    deps.push_back(Id(var));
+  }
+  for (uint32_t dep : deps) {
+    nodes_[dep].dependents.push_back(id);
+  }
+  nodes_[id].deps = std::move(deps);
+  nodes_[id].expr.emplace(std::move(compiled));
+
+  Relevel(downstream);
+  Mark(id);
+}
+
+template <typename T>
+std::vector<uint32_t> ExprGraph<T>::Downstream(uint32_t id) const {
+  std::vector<uint32_t> res = {id};
+  std::vector<bool> seen(nodes_.size());
+  seen[id] = true;
+  for (size_t i = 0; i < res.size(); ++i) {
+    for (uint32_t dependent : nodes_[res[i]].dependents) {
+      if (not seen[dependent]) {
+        seen[dependent] = true;
+        res.push_back(dependent);
+      }
+    }
+  }
+  return res;
+}
+
+// Recomputes the levels of nodes, which must be closed under dependents,
+// in topological order, and requeues the dirty ones whose level moved.
+template <typename T>
+void ExprGraph<T>::Relevel(const std::vector<uint32_t>& nodes) {
+  std::unordered_map<uint32_t, uint32_t> pending;
+  for (uint32_t id : nodes) {
+    pending.emplace(id, 0);
+  }
+  for (uint32_t id : nodes) {
+    for (uint32_t dep : nodes_[id].deps) {
+      if (pending.count(dep) != 0) {
+        ++pending[id];
+      }
+    }
+  }
+  std::vector<uint32_t> order;
+  for (uint32_t id : nodes) {
+    if (pending[id] == 0) {
+      order.push_back(id);
+    }
+  }
+  bool moved = false;
+  for (size_t i = 0; i < order.size(); ++i) {
+    Node& node = nodes_[order[i]];
+    uint32_t level = 0;
+    if (node.expr) {
+      level = 1;
+      for (uint32_t dep : node.deps) {
+        level = std::max(level, nodes_[dep].level + 1);
+      }
+    }
+    moved = moved or (node.dirty and level != node.level);
+    node.level = level;
+    for (uint32_t dependent : node.dependents) {
+      if (--pending[dependent] == 0) {
+        order.push_back(dependent);
+      }
+    }
+  }
+
+  if (moved) {
+    for (std::vector<uint32_t>& bucket : dirty_) {
+      bucket.clear();
+    }
+    for (uint32_t id = 0; id < nodes_.size(); ++id) {
+      if (nodes_[id].dirty) {
+        if (dirty_.size() <= nodes_[id].level) {
+          dirty_.resize(nodes_[id].level + 1);
+        }
+        dirty_[nodes_[id].level].push_back(id);
+      }
+    }
+  }
+}
+
+template <typename T>
+bool ExprGraph<T>::Recompute(Node& node) {
+  args_.clear();
+  bool has_value = true;
+  for (uint32_t dep : node.deps) {
+    if (not nodes_[dep].has_value) {
+      has_value = false;
+      break;
+    }
+    args_.push_back(nodes_[dep].value);
+  }
+  if (not has_value) {
+    bool changed = node.has_value;
+    node.has_value = false;
+    return changed;
+  }
+  T value = node.expr->Evaluate(args_.data());
+  bool changed = not node.has_value or not(node.value == value);
+  node.value = std::move(value);
+  node.has_value = true;
+  return changed;
+}
+
+template <typename T>
+size_t ExprGraph<T>::Update() {
+  size_t evaluated = 0;
+  // Dependents are always on a higher level, so a bucket does not grow
+  // while it is processed.
+  for (size_t level = 1; dirty_count_ != 0 and level < dirty_.size();
+       ++level) {
+    size_t i = 0;
+    try {
+      for (; i < dirty_[level].size(); ++i) {
+        uint32_t id = dirty_[level][i];
+        ++evaluated;
+        if (Recompute(nodes_[id])) {
+          MarkDependents(id);
+        }
+        nodes_[id].dirty = false;
+        --dirty_count_;
+      }
+    } catch (...) {
+      dirty_[level].erase(dirty_[level].begin(), dirty_[level].begin() + i);
+      throw;
+    }
+    dirty_[level].clear();
+  }
+  return evaluated;
+}
+
+template <typename T>
+const T& ExprGraph<T>::Get(const std::string& name) {
+  auto found = names_.find(name);
+  if (found == names_.end()) {
+    throw std::out_of_range("ExprGraph: unknown name " + name);
+  }
+  Update();
+  const Node& node = nodes_[found->second];
+  if (not node.has_value) {
+    throw std::out_of_range("ExprGraph: no value for " + name);
+  }
+  return node.value;
+}
+
+#endif  // #ifndef EXPR_GRAPH
@@ -1,125 +1,151 @@
 #ifndef EXPR_IN_POLISH_NOTATION_HPP
 #define EXPR_IN_POLISH_NOTATION_HPP
 
-#include <sstream>
 #include <stack>
-#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "AbstractToken.hpp"
+#include "ExprTokenizer.hpp"
+#include "InvalidExpr.hpp"
 #include "OperandToken.hpp"
 #include "OperatorToken.hpp"
+#include "TokenArena.hpp"
+#include "VariableToken.hpp"
 
-struct InvalidExpr : public std::exception {
-  const char* what() const noexcept override { return "Invalid expression!"; }
-};
-
+// Tokens are allocated in arena, or in an arena of the object when none
+// is given, and live as long as it does; nobody deletes them.
+// Conversion is iterative: nesting depth costs memory, not call stack.
 template <typename T>
 class ExprInPolishNotation {
  public:
-  ExprInPolishNotation(const std::string& expr);
+  ExprInPolishNotation(std::string_view expr, TokenArena* arena = nullptr);
   std::stack<AbstractToken*> GetTokens() { return tokens_; }
 
  private:
-  void ConvertInlineBrackets(std::stringstream& sstream);
-  bool CheckBrackets(const std::string& expr);
-  void ReadOperand(std::stringstream& sstream, int operands);
-  void UnloadOperators(std::stack<char>& operators, int operands);
-  void Clear();
+  // An open bracket (or the whole expression) being converted.
+  struct Frame {
+    size_t operators;  // Operators pending from outer frames.
+    int operands;      // 0 or 1: whether an operand was produced yet.
+    size_t position;   // Of the opening bracket.
+  };
+
+  void Convert();
+  void AddOperand(Frame& frame, size_t position);
+  void UnloadOperators(size_t base, int operands, size_t position);
+  void PushUnary(const ExprToken<T>& token);
+  // The text of an operator token, built once per operator.
+  static const std::string& OperatorString(char chr);
 
+  TokenArena own_arena_;
+  TokenArena* arena_;
+  ExprTokenizer<T> tokenizer_;
+  std::vector<const ExprToken<T>*> operators_;
   std::stack<AbstractToken*> tokens_;
 };
 
 template <typename T>
-ExprInPolishNotation<T>::ExprInPolishNotation(const std::string& expr) {
-  if (not CheckBrackets(expr)) {
-    throw InvalidExpr();
-  }
-  std::stringstream sstream;
-  sstream << expr;
-  ConvertInlineBrackets(sstream);
+ExprInPolishNotation<T>::ExprInPolishNotation(std::string_view expr,
+                                              TokenArena* arena)
+    : arena_(arena != nullptr ? arena : &own_arena_), tokenizer_(expr) {
+  Convert();
 }
 
 template <typename T>
-bool ExprInPolishNotation<T>::CheckBrackets(const std::string& expr) {
-  int balance = 0;
-  for (char chr : expr) {
-    if (chr == '(') {
-      balance += 1;
-    } else if (chr == ')') {
-      balance -= 1;
-    }
-    if (balance < 0) {
-      return false;
-    }
-  }
-  return balance == 0;
-}
-
-template <typename T>
-void ExprInPolishNotation<T>::ConvertInlineBrackets(
-    std::stringstream& sstream) {
-  std::stack<char> operators;
-  int operands = 0;
-  char chr;
-  while (sstream >> chr) {
-    switch (chr) {
-      case '-':
-      case '+':
-      case '/':
-      case '*':
-        operators.push(chr);
+void ExprInPolishNotation<T>::Convert() {
+  std::vector<Frame> frames = {{0, 0, 0}};
+  for (const ExprToken<T>& token : tokenizer_.Tokens()) {
+    switch (token.kind) {
+      case TokenKind::kOperator:
+        operators_.push_back(&token);
+        break;
+      case TokenKind::kOpenBracket:
+        frames.push_back({operators_.size(), 0, token.position});
         break;
-      case ')':
-        return;
-      case '(':
-        ConvertInlineBrackets(sstream);
-        UnloadOperators(operators, operands + 1);
-        operands = 1;
+      case TokenKind::kCloseBracket: {
+        Frame inner = frames.back();
+        if (operators_.size() != inner.operators) {
+          throw InvalidExpr(token.position, "expected an operand");
+        }
+        if (inner.operands == 0) {
+          throw InvalidExpr(inner.position, "empty brackets");
+        }
+        frames.pop_back();
+        AddOperand(frames.back(), inner.position);
         break;
-      default:
-        sstream.putback(chr);
-        T operand;
-        sstream >> operand;
-        auto* token = new OperandToken<T>(operand);
-        tokens_.push(token);
-        UnloadOperators(operators, operands + 1);
-        operands = 1;
+      }
+      case TokenKind::kName:
+        tokens_.push(arena_->Make<VariableToken>(std::string(token.text)));
+        AddOperand(frames.back(), token.position);
+        break;
+      case TokenKind::kNumber:
+        tokens_.push(arena_->Make<OperandToken<T>>(token.value, token.text));
+        AddOperand(frames.back(), token.position);
         break;
     }
   }
+  if (not operators_.empty()) {
+    throw InvalidExpr(tokenizer_.Size(), "expected an operand");
+  }
+  if (frames.back().operands == 0) {
+    throw InvalidExpr(0, "empty expression");
+  }
+}
+
+template <typename T>
+void ExprInPolishNotation<T>::AddOperand(Frame& frame, size_t position) {
+  UnloadOperators(frame.operators, frame.operands + 1, position);
+  frame.operands = 1;
 }
 
+// Applies the operators pending in the current frame, the ones above base,
+// to the operand just produced.
 template <typename T>
-void ExprInPolishNotation<T>::UnloadOperators(std::stack<char>& operators,
-                                              int operands) {
-  if (operators.empty()) {
+void ExprInPolishNotation<T>::UnloadOperators(size_t base, int operands,
+                                              size_t position) {
+  if (operators_.size() == base) {
     if (operands != 1) {
-      Clear();
-      throw InvalidExpr();
+      throw InvalidExpr(position, "expected an operator");
     }
     return;
   }
 
-  while (operators.size() > 1) {
-    auto op_str = std::string(1, operators.top());
-    tokens_.push(new UnaryOperatorToken<T>(op_str));
-    operators.pop();
+  while (operators_.size() > base + 1) {
+    PushUnary(*operators_.back());
+    operators_.pop_back();
   }
 
-  auto op_str = std::string(1, operators.top());
   if (operands == 2) {
-    tokens_.push(new BinaryOperatorToken<T>(op_str));
+    tokens_.push(arena_->Make<BinaryOperatorToken<T>>(
+        OperatorString(operators_.back()->chr)));
   } else {
-    tokens_.push(new UnaryOperatorToken<T>(op_str));
+    PushUnary(*operators_.back());
+  }
+  operators_.pop_back();
+}
+
+template <typename T>
+void ExprInPolishNotation<T>::PushUnary(const ExprToken<T>& token) {
+  if (token.chr != '+' and token.chr != '-') {
+    throw InvalidExpr(token.position, "expected an operand");
   }
-  operators.pop();
+  tokens_.push(
+      arena_->Make<UnaryOperatorToken<T>>(OperatorString(token.chr)));
 }
 
 template <typename T>
-void ExprInPolishNotation<T>::Clear() {
-  while (not tokens_.empty()) {
-    delete tokens_.top();
-    tokens_.pop();
+const std::string& ExprInPolishNotation<T>::OperatorString(char chr) {
+  static const std::string kOperators[] = {"+", "-", "*", "/"};
+  switch (chr) {
+    case '+':
+      return kOperators[0];
+    case '-':
+      return kOperators[1];
+    case '*':
+      return kOperators[2];
+    default:
+      return kOperators[3];
   }
 }
 
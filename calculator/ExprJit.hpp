@@ -0,0 +1,352 @@
+#ifndef EXPR_JIT
+#define EXPR_JIT
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#endif
+
+#include "CompiledExpr.hpp"
+#include "InvalidExpr.hpp"
+#include "OpCode.hpp"
+
+namespace jit_detail {
+
+#if defined(__x86_64__)
+
+// Translates a CompiledExpr program of double or int64_t into a System V
+// function T(const T* values). Every stack level and temporary gets its
+// own register, so the code touches memory only to read variables and
+// double constants. Programs that need more registers are rejected, as
+// are int64_t programs that divide.
+template <typename T>
+class X86Emitter {
+ public:
+  static constexpr bool kIsDouble = std::is_same_v<T, double>;
+  // rcx, rsi, r8 - r11, then the callee-saved rbx, r12 - r15. rax and rdx
+  // are left to idiv, rdi holds values.
+  static constexpr uint8_t kIntRegisters[] = {1, 6, 8, 9, 10, 11,
+                                              3, 12, 13, 14, 15};
+  static constexpr size_t kCallerSaved = 6;
+  static constexpr size_t kRegisters = kIsDouble ? 16 : 11;
+
+  // Returns false if the program does not fit in registers.
+  bool Emit(const CompiledExpr<T>& expr);
+  const std::vector<uint8_t>& Code() const { return code_; }
+
+ private:
+  uint8_t Register(size_t index) const {
+    return kIsDouble ? index : kIntRegisters[index];
+  }
+
+  void Byte(uint8_t byte) { code_.push_back(byte); }
+  void Bytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    code_.insert(code_.end(), bytes, bytes + size);
+  }
+  void Rex(bool wide, uint8_t reg, uint8_t rm) {
+    uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg >> 3) << 2 | rm >> 3;
+    if (rex != 0x40) {
+      Byte(rex);
+    }
+  }
+  void ModRm(uint8_t mod, uint8_t reg, uint8_t rm) {
+    Byte(mod << 6 | (reg & 7) << 3 | (rm & 7));
+  }
+
+  // op reg, rm with both operands registers.
+  void Sse(uint8_t prefix, uint8_t opcode, uint8_t reg, uint8_t rm);
+  void Int(uint8_t opcode, uint8_t reg, uint8_t rm);
+  // movsd / mov reg, [rdi + 8 * slot]
+  void LoadVariable(uint8_t reg, uint32_t slot);
+  // op reg, [rip + pool offset], patched once the code size is known.
+  void SseLiteral(uint8_t prefix, uint8_t opcode, uint8_t reg,
+                  size_t offset);
+
+  void Push(uint8_t reg, const T& value);
+  void Move(uint8_t dst, uint8_t src);
+  void Negate(uint8_t reg);
+  void Arithmetic(OpCode op, uint8_t dst, uint8_t src);
+
+  std::vector<uint8_t> code_;
+  std::vector<uint8_t> pool_;
+  std::vector<std::pair<size_t, size_t>> fixups_;
+};
+
+template <typename T>
+void X86Emitter<T>::Sse(uint8_t prefix, uint8_t opcode, uint8_t reg,
+                        uint8_t rm) {
+  Byte(prefix);
+  Rex(false, reg, rm);
+  Byte(0x0F);
+  Byte(opcode);
+  ModRm(3, reg, rm);
+}
+
+template <typename T>
+void X86Emitter<T>::Int(uint8_t opcode, uint8_t reg, uint8_t rm) {
+  Rex(true, reg, rm);
+  Byte(opcode);
+  ModRm(3, reg, rm);
+}
+
+template <typename T>
+void X86Emitter<T>::LoadVariable(uint8_t reg, uint32_t slot) {
+  uint32_t disp = slot * sizeof(T);
+  if constexpr (kIsDouble) {
+    Byte(0xF2);
+    Rex(false, reg, 0);
+    Byte(0x0F);
+    Byte(0x10);
+  } else {
+    Rex(true, reg, 0);
+    Byte(0x8B);
+  }
+  ModRm(2, reg, 7);
+  Bytes(&disp, sizeof(disp));
+}
+
+template <typename T>
+void X86Emitter<T>::SseLiteral(uint8_t prefix, uint8_t opcode, uint8_t reg,
+                               size_t offset) {
+  Byte(prefix);
+  Rex(false, reg, 0);
+  Byte(0x0F);
+  Byte(opcode);
+  ModRm(0, reg, 5);
+  fixups_.push_back({code_.size(), offset});
+  Bytes("\0\0\0\0", 4);
+}
+
+template <typename T>
+void X86Emitter<T>::Push(uint8_t reg, const T& value) {
+  if constexpr (kIsDouble) {
+    size_t offset = pool_.size();
+    pool_.resize(offset + sizeof(T));
+    std::memcpy(pool_.data() + offset, &value, sizeof(T));
+    SseLiteral(0xF2, 0x10, reg, offset);  // movsd
+  } else {
+    Rex(true, 0, reg);
+    Byte(0xB8 + (reg & 7));  // mov reg, imm64
+    Bytes(&value, sizeof(T));
+  }
+}
+
+template <typename T>
+void X86Emitter<T>::Move(uint8_t dst, uint8_t src) {
+  if (dst == src) {
+    return;
+  }
+  if constexpr (kIsDouble) {
+    Sse(0x66, 0x28, dst, src);  // movapd
+  } else {
+    Int(0x89, src, dst);
+  }
+}
+
+template <typename T>
+void X86Emitter<T>::Negate(uint8_t reg) {
+  if constexpr (kIsDouble) {
+    SseLiteral(0x66, 0x57, reg, 0);  // xorpd with the sign mask
+  } else {
+    Rex(true, 0, reg);
+    Byte(0xF7);
+    ModRm(3, 3, reg);
+  }
+}
+
+template <typename T>
+void X86Emitter<T>::Arithmetic(OpCode op, uint8_t dst, uint8_t src) {
+  if constexpr (kIsDouble) {
+    uint8_t opcode = op == OpCode::kAdd   ? 0x58
+                     : op == OpCode::kSub ? 0x5C
+                     : op == OpCode::kMul ? 0x59
+                                          : 0x5E;
+    Sse(0xF2, opcode, dst, src);
+    return;
+  }
+  switch (op) {
+    case OpCode::kAdd:
+      Int(0x01, src, dst);
+      break;
+    case OpCode::kSub:
+      Int(0x29, src, dst);
+      break;
+    case OpCode::kMul:
+      Rex(true, dst, src);
+      Bytes("\x0F\xAF", 2);  // imul dst, src
+      ModRm(3, dst, src);
+      break;
+    default:
+      Int(0x8B, 0, dst);  // mov rax, dst
+      Bytes("\x48\x99", 2);  // cqo
+      Rex(true, 0, src);
+      Byte(0xF7);  // idiv src
+      ModRm(3, 7, src);
+      Int(0x89, 0, dst);  // mov dst, rax
+      break;
+  }
+}
+
+template <typename T>
+bool X86Emitter<T>::Emit(const CompiledExpr<T>& expr) {
+  size_t used = expr.MaxDepth() + expr.Temps();
+  if (used > kRegisters) {
+    return false;
+  }
+  // idiv traps where the interpreter throws std::domain_error, so integer
+  // division stays with the interpreter.
+  if (not kIsDouble and std::find(expr.Code().begin(), expr.Code().end(),
+                                  OpCode::kDiv) != expr.Code().end()) {
+    return false;
+  }
+  // The sign mask for xorpd, which wants its operand 16-byte aligned.
+  uint64_t sign[2] = {uint64_t(1) << 63, 0};
+  pool_.assign(reinterpret_cast<const uint8_t*>(sign),
+               reinterpret_cast<const uint8_t*>(sign) + sizeof(sign));
+  for (size_t i = kCallerSaved; not kIsDouble and i < used; ++i) {
+    Rex(false, 0, kIntRegisters[i]);
+    Byte(0x50 + (kIntRegisters[i] & 7));  // push
+  }
+
+  const T* constant = expr.Constants().data();
+  const uint32_t* slot = expr.Slots().data();
+  size_t top = 0;
+  for (OpCode op : expr.Code()) {
+    switch (op) {
+      case OpCode::kPush:
+        Push(Register(top++), *constant++);
+        break;
+      case OpCode::kLoad:
+        LoadVariable(Register(top++), *slot++);
+        break;
+      case OpCode::kStore:
+        Move(Register(expr.MaxDepth() + *slot++), Register(top - 1));
+        break;
+      case OpCode::kRecall:
+        Move(Register(top++), Register(expr.MaxDepth() + *slot++));
+        break;
+      case OpCode::kNeg:
+        Negate(Register(top - 1));
+        break;
+      default:
+        --top;
+        Arithmetic(op, Register(top - 1), Register(top));
+        break;
+    }
+  }
+
+  if constexpr (not kIsDouble) {
+    Int(0x89, Register(0), 0);  // mov rax, result
+    for (size_t i = used; i-- > kCallerSaved;) {
+      Rex(false, 0, kIntRegisters[i]);
+      Byte(0x58 + (kIntRegisters[i] & 7));  // pop
+    }
+  }
+  Byte(0xC3);  // ret; a double result is already in xmm0.
+
+  code_.resize((code_.size() + 15) / 16 * 16, 0xCC);
+  size_t pool = code_.size();
+  for (auto [at, offset] : fixups_) {
+    int32_t disp = pool + offset - (at + 4);
+    std::memcpy(code_.data() + at, &disp, sizeof(disp));
+  }
+  code_.insert(code_.end(), pool_.begin(), pool_.end());
+  return true;
+}
+
+#endif  // #if defined(__x86_64__)
+
+}  // namespace jit_detail
+
+// An expression translated to native code. Available for double and
+// int64_t on x86-64, as long as the stack and temporaries of the program
+// fit in registers and an int64_t program does not divide; everywhere
+// else, and when mapping an executable page fails, it falls back to the
+// CompiledExpr interpreter. IsNative() tells
+// which one runs. Results are the same either way.
+template <typename T>
+class JitExpr {
+ public:
+  using Function = T (*)(const T* values);
+
+  explicit JitExpr(CompiledExpr<T> expr);
+  explicit JitExpr(std::string_view expr) : JitExpr(CompiledExpr<T>(expr)) {}
+  JitExpr(const JitExpr&) = delete;
+  JitExpr& operator=(const JitExpr&) = delete;
+  JitExpr(JitExpr&& other) noexcept : expr_(std::move(other.expr_)) {
+    std::swap(function_, other.function_);
+    std::swap(size_, other.size_);
+  }
+  JitExpr& operator=(JitExpr&& other) noexcept {
+    std::swap(expr_, other.expr_);
+    std::swap(function_, other.function_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~JitExpr();
+
+  T Evaluate() const { return Evaluate(nullptr); }
+  // values are in the order of Expr().Variables().
+  T Evaluate(const T* values) const {
+    if (function_ == nullptr) {
+      return expr_.Evaluate(values);
+    }
+    if (values == nullptr and not expr_.Variables().empty()) {
+      throw InvalidExpr("unbound variable " + expr_.Variables()[0]);
+    }
+    return function_(values);
+  }
+
+  bool IsNative() const { return function_ != nullptr; }
+  const CompiledExpr<T>& Expr() const { return expr_; }
+
+ private:
+  CompiledExpr<T> expr_;
+  Function function_ = nullptr;
+  size_t size_ = 0;
+};
+
+template <typename T>
+JitExpr<T>::JitExpr(CompiledExpr<T> expr) : expr_(std::move(expr)) {
+#if defined(__x86_64__)
+  if constexpr (std::is_same_v<T, double> or std::is_same_v<T, int64_t>) {
+    jit_detail::X86Emitter<T> emitter;
+    if (not emitter.Emit(expr_)) {
+      return;
+    }
+    const std::vector<uint8_t>& code = emitter.Code();
+    void* page = ::mmap(nullptr, code.size(), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+      return;
+    }
+    std::memcpy(page, code.data(), code.size());
+    if (::mprotect(page, code.size(), PROT_READ | PROT_EXEC) != 0) {
+      ::munmap(page, code.size());
+      return;
+    }
+    function_ = reinterpret_cast<Function>(page);
+    size_ = code.size();
+  }
+#endif
+}
+
+template <typename T>
+JitExpr<T>::~JitExpr() {
+#if defined(__x86_64__)
+  if (function_ != nullptr) {
+    ::munmap(reinterpret_cast<void*>(function_), size_);
+  }
+#endif
+}
+
+#endif  // #ifndef EXPR_JIT
@@ -0,0 +1,282 @@
+#ifndef EXPR_OPTIMIZER
+#define EXPR_OPTIMIZER
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "OpCode.hpp"
+
+// Rewrites a CompiledExpr program without changing its results:
+//   * subtrees of constants are evaluated once, here (except divisions
+//     by zero and, for integers, the ones that overflow, which are left
+//     to throw at run time);
+//   * x * 1, 1 * x, x / 1, x - 0 and - -x become x, as does x + 0 for
+//     types other than floating point, where it would lose a -0 (and
+//     x - -0 is kept for the same reason);
+//   * identical subtrees are hash-consed into one node. The rewritten
+//     program computes such a node once, saves it with kStore and reuses
+//     it with kRecall. Operands of + and * are put in a canonical order:
+//     the one needing the deeper stack first, which keeps the stack short
+//     (Sethi-Ullman), and the older one first among equals.
+// Both directions are iterative, so the depth of an expression is limited
+// by memory only.
+template <typename T>
+class ExprOptimizer {
+ public:
+  ExprOptimizer(const std::vector<OpCode>& code,
+                const std::vector<T>& constants,
+                const std::vector<uint32_t>& slots);
+
+  // Appends the optimized program; returns the number of temporaries.
+  size_t Emit(std::vector<OpCode>& code, std::vector<T>& constants,
+              std::vector<uint32_t>& slots) const;
+
+  size_t Nodes() const { return nodes_.size(); }
+
+ private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  // Children precede their parents in nodes_. A kPush node keeps the index
+  // of its value in lhs, a kLoad node the variable slot.
+  struct Node {
+    OpCode op;
+    uint32_t lhs;
+    uint32_t rhs;
+
+    bool operator==(const Node& other) const = default;
+  };
+  struct NodeHash {
+    size_t operator()(const Node& node) const {
+      uint64_t key = (uint64_t(node.lhs) << 32 | node.rhs) * 31 +
+                     static_cast<uint64_t>(node.op);
+      return std::hash<uint64_t>()(key);
+    }
+  };
+
+  static bool IsLeaf(OpCode op) {
+    return op == OpCode::kPush or op == OpCode::kLoad;
+  }
+  static T Apply(OpCode op, const T& lhs, const T& rhs);
+
+  bool IsValue(uint32_t id, int value) const {
+    return nodes_[id].op == OpCode::kPush and
+           values_[nodes_[id].lhs] == T(value);
+  }
+
+  bool IsPositiveZero(uint32_t id) const {
+    if constexpr (std::is_floating_point_v<T>) {
+      return IsValue(id, 0) and not std::signbit(values_[nodes_[id].lhs]);
+    }
+    return IsValue(id, 0);
+  }
+
+  uint32_t Intern(const Node& node);
+  uint32_t Constant(const T& value);
+  uint32_t Negate(uint32_t operand);
+  uint32_t Combine(OpCode op, uint32_t lhs, uint32_t rhs);
+
+  std::vector<Node> nodes_;
+  // Stack depth needed to evaluate each node.
+  std::vector<uint32_t> needs_;
+  std::vector<T> values_;
+  std::unordered_map<Node, uint32_t, NodeHash> interned_;
+  // Constants are shared by their object representation, which is only
+  // meaningful for trivially copyable types; others are never shared.
+  std::unordered_map<std::string, uint32_t> value_ids_;
+  uint32_t root_ = kNone;
+};
+
+template <typename T>
+ExprOptimizer<T>::ExprOptimizer(const std::vector<OpCode>& code,
+                                const std::vector<T>& constants,
+                                const std::vector<uint32_t>& slots) {
+  std::vector<uint32_t> stack;
+  nodes_.reserve(code.size());
+  needs_.reserve(code.size());
+  interned_.reserve(code.size());
+  const T* constant = constants.data();
+  const uint32_t* slot = slots.data();
+  for (OpCode op : code) {
+    if (op == OpCode::kPush) {
+      stack.push_back(Constant(*constant++));
+    } else if (op == OpCode::kLoad) {
+      stack.push_back(Intern(Node{op, *slot++, kNone}));
+    } else if (op == OpCode::kNeg) {
+      stack.back() = Negate(stack.back());
+    } else {
+      uint32_t rhs = stack.back();
+      stack.pop_back();
+      stack.back() = Combine(op, stack.back(), rhs);
+    }
+  }
+  root_ = stack.back();
+}
+
+template <typename T>
+T ExprOptimizer<T>::Apply(OpCode op, const T& lhs, const T& rhs) {
+  switch (op) {
+    case OpCode::kAdd:
+      return lhs + rhs;
+    case OpCode::kSub:
+      return lhs - rhs;
+    case OpCode::kMul:
+      return lhs * rhs;
+    default:
+      return lhs / rhs;
+  }
+}
+
+template <typename T>
+uint32_t ExprOptimizer<T>::Intern(const Node& node) {
+  auto [it, inserted] = interned_.emplace(node, nodes_.size());
+  if (inserted) {
+    uint32_t need = 1;
+    if (node.rhs != kNone) {
+      uint32_t lhs = needs_[node.lhs];
+      uint32_t rhs = needs_[node.rhs];
+      need = lhs == rhs ? lhs + 1 : std::max(lhs, rhs + 1);
+    } else if (not IsLeaf(node.op)) {
+      need = needs_[node.lhs];
+    }
+    nodes_.push_back(node);
+    needs_.push_back(need);
+  }
+  return it->second;
+}
+
+template <typename T>
+uint32_t ExprOptimizer<T>::Constant(const T& value) {
+  uint32_t index = values_.size();
+  if constexpr (std::is_trivially_copyable_v<T>) {
+    std::string bytes(reinterpret_cast<const char*>(&value), sizeof(T));
+    index = value_ids_.emplace(std::move(bytes), index).first->second;
+  }
+  if (index == values_.size()) {
+    values_.push_back(value);
+  }
+  return Intern(Node{OpCode::kPush, index, kNone});
+}
+
+template <typename T>
+uint32_t ExprOptimizer<T>::Negate(uint32_t operand) {
+  const Node& node = nodes_[operand];
+  if (node.op == OpCode::kPush) {
+    return Constant(-values_[node.lhs]);
+  }
+  if (node.op == OpCode::kNeg) {
+    return node.lhs;
+  }
+  return Intern(Node{OpCode::kNeg, operand, kNone});
+}
+
+template <typename T>
+uint32_t ExprOptimizer<T>::Combine(OpCode op, uint32_t lhs, uint32_t rhs) {
+  if (nodes_[lhs].op == OpCode::kPush and nodes_[rhs].op == OpCode::kPush and
+      not(op == OpCode::kDiv and
+          (IsValue(rhs, 0) or IsBadDivision(values_[nodes_[lhs].lhs],
+                                            values_[nodes_[rhs].lhs])))) {
+    return Constant(Apply(op, values_[nodes_[lhs].lhs],
+                          values_[nodes_[rhs].lhs]));
+  }
+  switch (op) {
+    case OpCode::kMul:
+      if (IsValue(rhs, 1)) {
+        return lhs;
+      }
+      if (IsValue(lhs, 1)) {
+        return rhs;
+      }
+      break;
+    case OpCode::kDiv:
+      if (IsValue(rhs, 1)) {
+        return lhs;
+      }
+      break;
+    case OpCode::kSub:
+      if (IsPositiveZero(rhs)) {
+        return lhs;
+      }
+      break;
+    case OpCode::kAdd:
+      if (not std::is_floating_point_v<T>) {
+        if (IsValue(rhs, 0)) {
+          return lhs;
+        }
+        if (IsValue(lhs, 0)) {
+          return rhs;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+  if ((op == OpCode::kAdd or op == OpCode::kMul) and
+      (needs_[lhs] < needs_[rhs] or
+       (needs_[lhs] == needs_[rhs] and rhs < lhs))) {
+    std::swap(lhs, rhs);
+  }
+  return Intern(Node{op, lhs, rhs});
+}
+
+template <typename T>
+size_t ExprOptimizer<T>::Emit(std::vector<OpCode>& code,
+                              std::vector<T>& constants,
+                              std::vector<uint32_t>& slots) const {
+  // Uses of every node reachable from the root. A parent always has a
+  // larger index than its children, so one backward sweep counts them.
+  std::vector<uint32_t> uses(nodes_.size());
+  uses[root_] = 1;
+  for (size_t id = nodes_.size(); id-- > 0;) {
+    const Node& node = nodes_[id];
+    if (uses[id] == 0 or IsLeaf(node.op)) {
+      continue;
+    }
+    ++uses[node.lhs];
+    if (node.rhs != kNone) {
+      ++uses[node.rhs];
+    }
+  }
+
+  std::vector<uint32_t> temps(nodes_.size(), kNone);
+  size_t temp_count = 0;
+  // Post-order walk; the flag tells whether the children are done.
+  std::vector<std::pair<uint32_t, bool>> stack = {{root_, false}};
+  while (not stack.empty()) {
+    auto [id, children_done] = stack.back();
+    stack.pop_back();
+    const Node& node = nodes_[id];
+    if (temps[id] != kNone) {
+      code.push_back(OpCode::kRecall);
+      slots.push_back(temps[id]);
+    } else if (node.op == OpCode::kPush) {
+      code.push_back(OpCode::kPush);
+      constants.push_back(values_[node.lhs]);
+    } else if (node.op == OpCode::kLoad) {
+      code.push_back(OpCode::kLoad);
+      slots.push_back(node.lhs);
+    } else if (not children_done) {
+      stack.push_back({id, true});
+      if (node.rhs != kNone) {
+        stack.push_back({node.rhs, false});
+      }
+      stack.push_back({node.lhs, false});
+    } else {
+      code.push_back(node.op);
+      if (uses[id] > 1) {
+        temps[id] = temp_count++;
+        code.push_back(OpCode::kStore);
+        slots.push_back(temps[id]);
+      }
+    }
+  }
+  return temp_count;
+}
+
+#endif  // #ifndef EXPR_OPTIMIZER
@@ -0,0 +1,151 @@
+#ifndef EXPR_TOKENIZER
+#define EXPR_TOKENIZER
+
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "InvalidExpr.hpp"
+
+enum class TokenKind : uint8_t {
+  kNumber,
+  kName,
+  kOperator,
+  kOpenBracket,
+  kCloseBracket,
+};
+
+template <typename T>
+struct ExprToken {
+  TokenKind kind;
+  char chr;               // The operator or bracket itself.
+  size_t position;        // Offset of the first character in the input.
+  std::string_view text;  // The name or the digits of the token.
+  T value;                // The value of a kNumber token.
+};
+
+// Splits an expression into tokens in one pass over the input. Numbers of
+// arithmetic types are read with std::from_chars; other types go through
+// their stream extractor. Brackets are checked to match on the way.
+// Names refer into the input, which must outlive the tokenizer.
+template <typename T>
+class ExprTokenizer {
+ public:
+  explicit ExprTokenizer(std::string_view expr);
+
+  const std::vector<ExprToken<T>>& Tokens() const { return tokens_; }
+  size_t Size() const { return expr_.size(); }
+
+ private:
+  static bool IsNameChar(char chr) {
+    return std::isalnum(static_cast<unsigned char>(chr)) or chr == '_';
+  }
+
+  size_t ReadNumber(size_t pos, T& value) const;
+  size_t ReadName(size_t pos) const;
+
+  std::string_view expr_;
+  std::vector<ExprToken<T>> tokens_;
+};
+
+template <typename T>
+ExprTokenizer<T>::ExprTokenizer(std::string_view expr) : expr_(expr) {
+  // Every token takes at least one character.
+  tokens_.reserve(expr.size());
+  std::vector<size_t> brackets;
+  size_t pos = 0;
+  while (pos < expr_.size()) {
+    char chr = expr_[pos];
+    ExprToken<T> token{TokenKind::kOperator, chr, pos, {}, T()};
+    switch (chr) {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        ++pos;
+        continue;
+      case '+':
+      case '-':
+      case '*':
+      case '/':
+        ++pos;
+        break;
+      case '(':
+        token.kind = TokenKind::kOpenBracket;
+        brackets.push_back(pos++);
+        break;
+      case ')':
+        if (brackets.empty()) {
+          throw InvalidExpr(pos, "unmatched ')'");
+        }
+        token.kind = TokenKind::kCloseBracket;
+        brackets.pop_back();
+        ++pos;
+        break;
+      default:
+        if (std::isalpha(static_cast<unsigned char>(chr)) or chr == '_') {
+          token.kind = TokenKind::kName;
+          token.text = expr_.substr(pos, ReadName(pos));
+          pos += token.text.size();
+        } else if (std::isdigit(static_cast<unsigned char>(chr)) or
+                   chr == '.') {
+          token.kind = TokenKind::kNumber;
+          token.text = expr_.substr(pos, ReadNumber(pos, token.value));
+          pos += token.text.size();
+        } else {
+          throw InvalidExpr(pos, std::string("unexpected '") + chr + "'");
+        }
+        break;
+    }
+    tokens_.push_back(token);
+  }
+  if (not brackets.empty()) {
+    throw InvalidExpr(brackets.back(), "unmatched '('");
+  }
+}
+
+template <typename T>
+size_t ExprTokenizer<T>::ReadName(size_t pos) const {
+  size_t end = pos;
+  while (end < expr_.size() and IsNameChar(expr_[end])) {
+    ++end;
+  }
+  return end - pos;
+}
+
+// Returns the length of the number.
+template <typename T>
+size_t ExprTokenizer<T>::ReadNumber(size_t pos, T& value) const {
+  const char* begin = expr_.data() + pos;
+  if constexpr (std::is_arithmetic_v<T>) {
+    const char* end = expr_.data() + expr_.size();
+    auto [ptr, error] = std::from_chars(begin, end, value);
+    if (error == std::errc::result_out_of_range) {
+      throw InvalidExpr(pos, "number out of range");
+    }
+    if (error != std::errc()) {
+      throw InvalidExpr(pos, "malformed number");
+    }
+    return ptr - begin;
+  } else {
+    size_t size = 0;
+    while (pos + size < expr_.size() and
+           (IsNameChar(begin[size]) or begin[size] == '.')) {
+      ++size;
+    }
+    std::istringstream stream(std::string(begin, size));
+    if (not(stream >> value) or stream.peek() != EOF) {
+      throw InvalidExpr(pos, "malformed number");
+    }
+    return size;
+  }
+}
+
+#endif  // #ifndef EXPR_TOKENIZER
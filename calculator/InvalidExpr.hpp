@@ -0,0 +1,31 @@
+#ifndef INVALID_EXPR
+#define INVALID_EXPR
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+class InvalidExpr : public std::exception {
+ public:
+  static const size_t kNoPosition = static_cast<size_t>(-1);
+
+  InvalidExpr() = default;
+  // position is the offset of the offending character in the input.
+  InvalidExpr(size_t position, const std::string& reason)
+      : position_(position),
+        message_("Invalid expression at " + std::to_string(position) + ": " +
+                 reason) {}
+
+  // For errors that belong to no single character.
+  explicit InvalidExpr(const std::string& reason)
+      : message_("Invalid expression: " + reason) {}
+
+  const char* what() const noexcept override { return message_.c_str(); }
+  size_t Position() const { return position_; }
+
+ private:
+  size_t position_ = kNoPosition;
+  std::string message_ = "Invalid expression!";
+};
+
+#endif  // #ifndef INVALID_EXPR
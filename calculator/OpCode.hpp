@@ -0,0 +1,65 @@
+#ifndef OP_CODE
+#define OP_CODE
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+// Instructions of the CompiledExpr stack machine. Operands of kPush, kLoad,
+// kStore and kRecall are not encoded in the program; they are taken in
+// order from the constant and slot arrays next to it.
+enum class OpCode : uint8_t {
+  kPush,    // Pushes the next constant.
+  kLoad,    // Pushes the variable named by the next slot.
+  kStore,   // Copies the top into the temporary named by the next slot.
+  kRecall,  // Pushes the temporary named by the next slot.
+  kNeg,
+  kAdd,
+  kSub,
+  kMul,
+  kDiv,
+};
+
+// Change of the stack size after op.
+inline int StackEffect(OpCode op) {
+  switch (op) {
+    case OpCode::kPush:
+    case OpCode::kLoad:
+    case OpCode::kRecall:
+      return 1;
+    case OpCode::kStore:
+    case OpCode::kNeg:
+      return 0;
+    default:
+      return -1;
+  }
+}
+
+// Whether lhs / rhs is undefined for an integral T: division by zero, or
+// the one signed quotient that overflows. The hardware traps on both.
+template <typename T>
+bool IsBadDivision(const T& lhs, const T& rhs) {
+  if constexpr (std::is_integral_v<T>) {
+    if (rhs == 0) {
+      return true;
+    }
+    if constexpr (std::is_signed_v<T>) {
+      return rhs == -1 and lhs == std::numeric_limits<T>::min();
+    }
+  }
+  return false;
+}
+
+// kDiv as the stack machine runs it: a bad division throws
+// std::domain_error instead of killing the process.
+template <typename T>
+T Divide(const T& lhs, const T& rhs) {
+  if (IsBadDivision(lhs, rhs)) {
+    throw std::domain_error(rhs == 0 ? "division by zero"
+                                     : "division overflows");
+  }
+  return lhs / rhs;
+}
+
+#endif  // #ifndef OP_CODE
@@ -1,17 +1,30 @@
 #ifndef OPERAND_TOKEN
 #define OPERAND_TOKEN
 
+#include <string>
+#include <string_view>
+
 #include "AbstractToken.hpp"
 
 template <typename T>
 class OperandToken : public AbstractToken {
  public:
+  // to_string is looked up next to T as well, so that types like BigInt
+  // can provide their own.
   OperandToken(const T& value)
-      : value_(value), AbstractToken(std::to_string(value)) {}
+      : AbstractToken(ToString(value)), value_(value) {}
+  // text is how the value was written; saves formatting it again.
+  OperandToken(const T& value, std::string_view text)
+      : AbstractToken(std::string(text)), value_(value) {}
 
   const T& GetValue() { return value_; }
 
  private:
+  static std::string ToString(const T& value) {
+    using std::to_string;
+    return to_string(value);
+  }
+
   T value_;
 };
 
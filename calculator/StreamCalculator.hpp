@@ -0,0 +1,51 @@
+#ifndef STREAM_CALCULATOR
+#define STREAM_CALCULATOR
+
+#include <cstdint>
+#include <exception>
+#include <string_view>
+
+#include "../iostream/iostream.hpp"
+#include "CompiledExpr.hpp"
+#include "TokenArena.hpp"
+
+struct StreamCalculatorStats {
+  uint64_t lines = 0;
+  uint64_t errors = 0;
+};
+
+// Evaluates a stream of newline-delimited expressions in one pass. Lines
+// are parsed straight out of the input buffer and share one TokenArena,
+// so memory stays bounded by the longest line whatever the input size.
+// Every input line produces one output line: the value, printed by the
+// stdlike::ostream printer for T, or the message of the exception the line
+// threw: InvalidExpr, std::domain_error from a bad division, or any other
+// std::exception, such as std::bad_alloc.
+template <typename T>
+class StreamCalculator {
+ public:
+  static StreamCalculatorStats Run(stdlike::istream& in,
+                                   stdlike::ostream& out);
+};
+
+template <typename T>
+StreamCalculatorStats StreamCalculator<T>::Run(stdlike::istream& in,
+                                               stdlike::ostream& out) {
+  StreamCalculatorStats stats;
+  TokenArena arena;
+  std::string_view line;
+  while (in.getline(line)) {
+    ++stats.lines;
+    try {
+      out << CompiledExpr<T>(line, arena, false).Evaluate();
+    } catch (const std::exception& error) {
+      ++stats.errors;
+      out << error.what();
+    }
+    out.put('\n');
+  }
+  out.flush();
+  return stats;
+}
+
+#endif  // #ifndef STREAM_CALCULATOR
@@ -0,0 +1,96 @@
+#ifndef TOKEN_ARENA
+#define TOKEN_ARENA
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for the tokens of one parse. Make() places a token in the
+// current chunk; nothing is freed individually. Reset() destroys every
+// token at once and merges the chunks into one, so an arena reused across
+// parses stops allocating once it has grown to the largest expression.
+class TokenArena {
+ public:
+  static const size_t kFirstChunk = 4096;
+
+  TokenArena() = default;
+  TokenArena(const TokenArena&) = delete;
+  TokenArena& operator=(const TokenArena&) = delete;
+  ~TokenArena() { Reset(); }
+
+  template <typename Token, typename... Args>
+  Token* Make(Args&&... args);
+
+  void Reset();
+
+  // Bytes held in chunks, used or not.
+  size_t Capacity() const;
+
+ private:
+  struct Chunk {
+    std::unique_ptr<std::byte[]> memory;
+    size_t size;
+  };
+  using Destructor = void (*)(void*);
+
+  void* Allocate(size_t size, size_t align);
+  void AddChunk(size_t size) {
+    chunks_.push_back(
+        {std::unique_ptr<std::byte[]>(new std::byte[size]), size});
+  }
+
+  std::vector<Chunk> chunks_;
+  size_t used_ = 0;  // In the last chunk.
+  std::vector<std::pair<void*, Destructor>> destructors_;
+};
+
+template <typename Token, typename... Args>
+Token* TokenArena::Make(Args&&... args) {
+  void* memory = Allocate(sizeof(Token), alignof(Token));
+  Token* token = new (memory) Token(std::forward<Args>(args)...);
+  if constexpr (not std::is_trivially_destructible_v<Token>) {
+    destructors_.push_back(
+        {token, [](void* ptr) { static_cast<Token*>(ptr)->~Token(); }});
+  }
+  return token;
+}
+
+inline void* TokenArena::Allocate(size_t size, size_t align) {
+  size_t offset = (used_ + align - 1) / align * align;
+  if (chunks_.empty() or offset + size > chunks_.back().size) {
+    size_t chunk = chunks_.empty() ? kFirstChunk : 2 * chunks_.back().size;
+    while (chunk < size + align) {
+      chunk *= 2;
+    }
+    AddChunk(chunk);
+    offset = 0;
+  }
+  used_ = offset + size;
+  return chunks_.back().memory.get() + offset;
+}
+
+inline void TokenArena::Reset() {
+  for (size_t i = destructors_.size(); i-- > 0;) {
+    destructors_[i].second(destructors_[i].first);
+  }
+  destructors_.clear();
+  if (chunks_.size() > 1) {
+    size_t capacity = Capacity();
+    chunks_.clear();
+    AddChunk(capacity);
+  }
+  used_ = 0;
+}
+
+inline size_t TokenArena::Capacity() const {
+  size_t capacity = 0;
+  for (const Chunk& chunk : chunks_) {
+    capacity += chunk.size;
+  }
+  return capacity;
+}
+
+#endif  // #ifndef TOKEN_ARENA
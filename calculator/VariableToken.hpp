@@ -0,0 +1,14 @@
+#ifndef VARIABLE_TOKEN
+#define VARIABLE_TOKEN
+
+#include <string>
+
+#include "AbstractToken.hpp"
+
+// A named input of an expression. Its value is supplied at evaluation.
+class VariableToken : public AbstractToken {
+ public:
+  VariableToken(const std::string& name) : AbstractToken(name) {}
+};
+
+#endif  // #ifndef VARIABLE_TOKEN
@@ -0,0 +1,140 @@
+// Parse and evaluation throughput of Calculator on very long expressions.
+//
+//   g++ -std=c++20 -O2 calculator_bench.cpp -o calculator_bench
+//   ./calculator_bench [terms] [seconds per measurement] > results.csv
+//
+// Every row reports the best time over repeated runs of one phase. Each
+// phase includes the ones before it, except evaluate, which runs an
+// already compiled expression.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Calculator.hpp"
+#include "CompiledExpr.hpp"
+#include "ExprInPolishNotation.hpp"
+#include "ExprTokenizer.hpp"
+#include "TokenArena.hpp"
+
+namespace {
+
+double min_seconds = 0.5;
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename F>
+double Measure(F&& func) {
+  using Clock = std::chrono::steady_clock;
+  double best = 1e300;
+  double total = 0;
+  size_t runs = 0;
+  while (total < min_seconds or runs < 3) {
+    Clock::time_point start = Clock::now();
+    func();
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    best = elapsed < best ? elapsed : best;
+    total += elapsed;
+    ++runs;
+  }
+  return best;
+}
+
+void Report(const char* shape, size_t terms, const char* phase,
+            double seconds, size_t bytes) {
+  std::printf("%s,%zu,%s,%.6f,%.3f,%.3f\n", shape, terms, phase, seconds,
+              terms / seconds * 1e-6, bytes / seconds * 1e-6);
+}
+
+// x + 1 * 2 - x / 3 + ...: one long flat chain.
+std::string Flat(size_t terms) {
+  const char* kOps = "+*-/";
+  std::string expr = "x";
+  for (size_t i = 1; i < terms; ++i) {
+    expr += ' ';
+    expr += kOps[i % 4];
+    expr += ' ';
+    expr += i % 3 == 0 ? "x" : std::to_string(i % 7 + 1);
+  }
+  return expr;
+}
+
+// (x - (2 - (x - ... ))): terms nested brackets. Subtraction does not
+// commute, so the evaluation stack is as deep as the nesting.
+std::string Nested(size_t terms) {
+  std::string expr;
+  for (size_t i = 1; i < terms; ++i) {
+    expr += i % 2 == 0 ? "(x - " : "(2 - ";
+  }
+  expr += "x";
+  expr.append(terms - 1, ')');
+  return expr;
+}
+
+// (x * y - 1) repeated: one shared subexpression.
+std::string Repeated(size_t terms) {
+  std::string expr = "(x * y - 1)";
+  for (size_t i = 3; i < terms; i += 3) {
+    expr += " + (x * y - 1)";
+  }
+  return expr;
+}
+
+void Run(const char* shape, size_t terms, const std::string& expr) {
+  size_t bytes = expr.size();
+  TokenArena arena;
+
+  double secs = Measure([&] {
+    ExprTokenizer<double> tokenizer(expr);
+    DoNotOptimize(tokenizer.Tokens().size());
+  });
+  Report(shape, terms, "tokenize", secs, bytes);
+
+  secs = Measure([&] {
+    ExprInPolishNotation<double> parsed(expr, &arena);
+    DoNotOptimize(parsed.GetTokens().size());
+    arena.Reset();
+  });
+  Report(shape, terms, "parse", secs, bytes);
+
+  secs = Measure([&] {
+    CompiledExpr<double> compiled(expr, arena, false);
+    DoNotOptimize(compiled.Code().size());
+  });
+  Report(shape, terms, "compile", secs, bytes);
+
+  secs = Measure([&] {
+    CompiledExpr<double> compiled(expr, arena);
+    DoNotOptimize(compiled.Code().size());
+  });
+  Report(shape, terms, "compile_optimize", secs, bytes);
+
+  CompiledExpr<double> compiled(expr, arena);
+  double values[] = {1.5, 0.5};
+  secs = Measure([&] { DoNotOptimize(compiled.Evaluate(values)); });
+  Report(shape, terms, "evaluate", secs, bytes);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t terms = 1000000;
+  if (argc > 1) {
+    terms = std::strtoull(argv[1], nullptr, 10);
+  }
+  if (argc > 2) {
+    min_seconds = std::atof(argv[2]);
+  }
+  std::printf("shape,terms,phase,seconds,mterms_per_s,mbytes_per_s\n");
+  Run("flat", terms, Flat(terms));
+  Run("nested", terms, Nested(terms));
+  Run("repeated", terms, Repeated(terms));
+  return 0;
+}
@@ -6,8 +6,10 @@
 
 #include "iostream.hpp"
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 stdlike::ostream stdlike::cout =
@@ -224,6 +226,67 @@ char stdlike::istream::peek() {
   return peeked_;
 }
 
+bool stdlike::istream::getline(std::string_view &line) {
+  if (tied_ != nullptr) {
+    tied_->flush();
+  }
+  if (bad()) {
+    return false;
+  }
+  failbit_ = false;
+  is_peeked_ = false;
+  if (buff_ == nullptr) {
+    init_buff();
+  }
+
+  std::size_t scanned = buff_read_;
+  while (true) {
+    const void *end = memchr(buff_ + scanned, '\n', buff_sz_ - scanned);
+    if (end != nullptr) {
+      std::size_t line_end = static_cast<const char *>(end) - buff_;
+      line = std::string_view(buff_ + buff_read_, line_end - buff_read_);
+      buff_read_ = line_end + 1;
+      return true;
+    }
+    scanned = buff_sz_ - buff_read_;
+    if (not refill()) {
+      if (scanned == 0) {
+        badbit_ = true;
+        return false;
+      }
+      line = std::string_view(buff_ + buff_read_, scanned);
+      buff_read_ = buff_sz_;
+      return true;
+    }
+  }
+}
+
+// Moves the unread part to the front of the buffer and reads after it,
+// doubling the buffer if the unread part fills it. Returns false if
+// nothing could be read.
+bool stdlike::istream::refill() {
+  std::size_t rest = buff_sz_ - buff_read_;
+  if (rest == buff_cap_) {
+    char *grown = new char[2 * buff_cap_];
+    memcpy(grown, buff_ + buff_read_, rest);
+    delete[] buff_;
+    buff_ = grown;
+    buff_cap_ *= 2;
+  } else {
+    memmove(buff_, buff_ + buff_read_, rest);
+  }
+  buff_read_ = 0;
+  buff_sz_ = rest;
+
+  ssize_t res = read(fd_, buff_ + buff_sz_, buff_cap_ - buff_sz_);
+  if (res <= 0) {
+    badbit_ = res < 0;
+    return false;
+  }
+  buff_sz_ += res;
+  return true;
+}
+
 bool stdlike::istream::fail() const { return failbit_ or badbit_; }
 bool stdlike::istream::bad() const { return badbit_; }
 
@@ -348,20 +411,22 @@ template <typename T> stdlike::ostream &stdlike::ostream::PrintInt(T num) {
     return *this;
   }
 
-  bool neg = num < 0;
+  using Unsigned = std::make_unsigned_t<T>;
+  Unsigned abs = num;
 
-  if (neg) {
+  if (num < 0) {
     put('-');
+    abs = -abs;
   }
 
-  size_t denum = neg ? -1 : 1;
+  Unsigned denum = 1;
 
-  while (num / denum >= 10) {
+  while (abs / denum >= 10) {
     denum *= 10;
   }
 
   while (denum != 0) {
-    put(num / denum % 10 + '0');
+    put(abs / denum % 10 + '0');
     denum /= 10;
   }
 
@@ -373,8 +438,7 @@ template <typename T> stdlike::ostream &stdlike::ostream::PrintFloat(T num) {
     return *this;
   }
 
-  if (num == std::numeric_limits<T>::quiet_NaN() or
-      num == std::numeric_limits<T>::signaling_NaN()) {
+  if (num != num) {
     *this << "nan";
     return *this;
   }
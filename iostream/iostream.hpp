@@ -2,6 +2,7 @@
 #define IOSTREAM
 
 #include <string>
+#include <string_view>
 
 namespace stdlike {
 
@@ -36,6 +37,11 @@ public:
   char get();
   char peek();
 
+  // Points line at the next line in the buffer, without the '\n'. The view
+  // is valid until the next read from the stream. The buffer grows only
+  // if a line does not fit in it. Returns false at the end of input.
+  bool getline(std::string_view &line);
+
   bool fail() const;
   bool bad() const;
 
@@ -49,6 +55,7 @@ private:
   void skip_spaces();
   void skip_until_space();
   void readline();
+  bool refill();
   void init_buff();
 
   int fd_ = 0;
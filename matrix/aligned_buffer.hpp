@@ -0,0 +1,80 @@
+#ifndef ALIGNED_BUFFER
+#define ALIGNED_BUFFER
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "matrix_kernels.hpp"
+
+template <typename T>
+class AlignedBuffer {
+ public:
+  AlignedBuffer() = default;
+  // The uninitialized_* algorithms destroy what they built before
+  // rethrowing, so only the block itself is left to free.
+  explicit AlignedBuffer(size_t size) : data_(Allocate(size)), size_(size) {
+    try {
+      std::uninitialized_value_construct_n(data_, size_);
+    } catch (...) {
+      Deallocate(data_);
+      throw;
+    }
+  }
+  AlignedBuffer(const AlignedBuffer& other)
+      : data_(Allocate(other.size_)), size_(other.size_) {
+    try {
+      std::uninitialized_copy_n(other.data_, size_, data_);
+    } catch (...) {
+      Deallocate(data_);
+      throw;
+    }
+  }
+  AlignedBuffer(AlignedBuffer&& other) noexcept { Swap(other); }
+  AlignedBuffer& operator=(AlignedBuffer other) noexcept {
+    Swap(other);
+    return *this;
+  }
+  ~AlignedBuffer() { Clear(); }
+
+  void Swap(AlignedBuffer& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+  }
+
+  T* Data() { return data_; }
+  const T* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+  T& operator[](size_t idx) { return data_[idx]; }
+  const T& operator[](size_t idx) const { return data_[idx]; }
+
+ private:
+  static T* Allocate(size_t size) {
+    if (size == 0) {
+      return nullptr;
+    }
+    return static_cast<T*>(::operator new(
+        size * sizeof(T), std::align_val_t(matrix_kernels::kAlignment)));
+  }
+
+  static void Deallocate(T* data) {
+    ::operator delete(data, std::align_val_t(matrix_kernels::kAlignment));
+  }
+
+  void Clear() {
+    if (data_ == nullptr) {
+      return;
+    }
+    std::destroy_n(data_, size_);
+    Deallocate(data_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#endif  // #ifndef ALIGNED_BUFFER
@@ -0,0 +1,247 @@
+#ifndef DYNAMIC_MATRIX
+#define DYNAMIC_MATRIX
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "aligned_buffer.hpp"
+#include "matrix.hpp"
+#include "matrix_expr.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+template <typename T = int64_t, typename L = ColumnMajor>
+class DynamicMatrix : public MatrixExpr<DynamicMatrix<T, L>> {
+ public:
+  using ValueType = T;
+  using Layout = L;
+  static constexpr size_t kRows = kDynamicExtent;
+  static constexpr size_t kCols = kDynamicExtent;
+  static constexpr bool kIsLeaf = true;
+
+  DynamicMatrix() = default;
+  DynamicMatrix(size_t rows, size_t cols)
+      : rows_(rows), cols_(cols), matrix_(rows * cols) {}
+  DynamicMatrix(size_t rows, size_t cols, const T& elem);
+
+  explicit DynamicMatrix(const std::vector<std::vector<T>>& matrix);
+  DynamicMatrix(const DynamicMatrix& other) = default;
+  DynamicMatrix(DynamicMatrix&& other) noexcept { Swap(other); }
+  template <typename E>
+  DynamicMatrix(const MatrixExpr<E>& expr)
+      : DynamicMatrix(expr.Self().Rows(), expr.Self().Cols()) {
+    AssignExpr<Layout>(matrix_.Data(), rows_, cols_, expr.Self());
+  }
+
+  DynamicMatrix& operator=(DynamicMatrix other) noexcept {
+    Swap(other);
+    return *this;
+  }
+  template <typename E>
+  DynamicMatrix& operator=(const MatrixExpr<E>& expr);
+
+  T& operator()(size_t height, size_t width) {
+    return matrix_[Layout::Index(height, width, rows_, cols_)];
+  }
+  const T& operator()(size_t height, size_t width) const {
+    return matrix_[Layout::Index(height, width, rows_, cols_)];
+  }
+
+  size_t Rows() const { return rows_; }
+  size_t Cols() const { return cols_; }
+  const T& Element(size_t idx) const { return matrix_[idx]; }
+  T* Data() { return matrix_.Data(); }
+  const T* Data() const { return matrix_.Data(); }
+
+  void Swap(DynamicMatrix& other) noexcept;
+
+  static DynamicMatrix Identity(size_t size);
+
+  DynamicMatrix Transposed() const;
+  void Transpose();
+  T Trace() const;
+  DynamicMatrix Pow(uint64_t exponent) const;
+
+  DynamicMatrix& operator+=(const DynamicMatrix& other);
+  DynamicMatrix& operator-=(const DynamicMatrix& other);
+  DynamicMatrix& operator*=(const T& mult);
+
+  template <typename E>
+  DynamicMatrix& operator+=(const MatrixExpr<E>& expr) {
+    return *this = *this + expr.Self();
+  }
+  template <typename E>
+  DynamicMatrix& operator-=(const MatrixExpr<E>& expr) {
+    return *this = *this - expr.Self();
+  }
+
+ private:
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  AlignedBuffer<T> matrix_;
+};
+
+template <typename Lhs, typename Rhs>
+  requires(not IsStaticShape<Lhs, Rhs>())
+DynamicMatrix<typename Lhs::ValueType, typename Lhs::Layout> operator*(
+    const MatrixExpr<Lhs>& lhs, const MatrixExpr<Rhs>& rhs) {
+  using Result = DynamicMatrix<typename Lhs::ValueType, typename Lhs::Layout>;
+  return Result(lhs) * Result(rhs);
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L>::DynamicMatrix(size_t rows, size_t cols, const T& elem)
+    : DynamicMatrix(rows, cols) {
+  for (size_t i = 0; i < rows_ * cols_; ++i) {
+    matrix_[i] = elem;
+  }
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L>::DynamicMatrix(const std::vector<std::vector<T>>& matrix)
+    : DynamicMatrix(matrix.size(), matrix.empty() ? 0 : matrix[0].size()) {
+  for (size_t i = 0; i < rows_; ++i) {
+    if (matrix[i].size() != cols_) {
+      throw std::invalid_argument("Matrix rows have different lengths");
+    }
+    for (size_t j = 0; j < cols_; ++j) {
+      operator()(i, j) = matrix[i][j];
+    }
+  }
+}
+
+template <typename T, typename L>
+template <typename E>
+DynamicMatrix<T, L>& DynamicMatrix<T, L>::operator=(
+    const MatrixExpr<E>& expr) {
+  const E& self = expr.Self();
+  if (self.Rows() == rows_ and self.Cols() == cols_) {
+    AssignExpr<Layout>(matrix_.Data(), rows_, cols_, self);
+  } else {
+    DynamicMatrix<T, L> res(self);
+    Swap(res);
+  }
+  return *this;
+}
+
+template <typename T, typename L>
+void DynamicMatrix<T, L>::Swap(DynamicMatrix& other) noexcept {
+  std::swap(rows_, other.rows_);
+  std::swap(cols_, other.cols_);
+  matrix_.Swap(other.matrix_);
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> DynamicMatrix<T, L>::Transposed() const {
+  DynamicMatrix<T, L> transposed(cols_, rows_);
+  LayoutTranspose<L>(rows_, cols_, Data(), transposed.Data());
+  return transposed;
+}
+
+template <typename T, typename L>
+void DynamicMatrix<T, L>::Transpose() {
+  if (rows_ == cols_) {
+    matrix_kernels::TransposeSquare(rows_, Data(), rows_);
+  } else {
+    *this = Transposed();
+  }
+}
+
+template <typename T, typename L>
+T DynamicMatrix<T, L>::Trace() const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Trace of a non-square matrix");
+  }
+  T res{};
+  for (size_t i = 0; i < rows_; ++i) {
+    res += operator()(i, i);
+  }
+  return res;
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> DynamicMatrix<T, L>::Identity(size_t size) {
+  DynamicMatrix<T, L> identity(size, size);
+  for (size_t i = 0; i < size; ++i) {
+    identity(i, i) = T(1);
+  }
+  return identity;
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> DynamicMatrix<T, L>::Pow(uint64_t exponent) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Power of a non-square matrix");
+  }
+  DynamicMatrix<T, L> res = Identity(rows_);
+  DynamicMatrix<T, L> base = *this;
+  DynamicMatrix<T, L> spare(rows_, cols_);
+  auto multiply_into = [this](const DynamicMatrix<T, L>& lhs,
+                              const DynamicMatrix<T, L>& rhs,
+                              DynamicMatrix<T, L>& out) {
+    for (size_t i = 0; i < rows_ * cols_; ++i) {
+      out.matrix_[i] = T();
+    }
+    LayoutGemm<L>(rows_, rows_, rows_, lhs.Data(), rhs.Data(), out.Data());
+  };
+  for (; exponent != 0; exponent >>= 1) {
+    if ((exponent & 1) != 0) {
+      multiply_into(res, base, spare);
+      res.Swap(spare);
+    }
+    if (exponent > 1) {
+      multiply_into(base, base, spare);
+      base.Swap(spare);
+    }
+  }
+  return res;
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L>& DynamicMatrix<T, L>::operator+=(
+    const DynamicMatrix& other) {
+  CheckSameShape(*this, other);
+  matrix_kernels::Add(matrix_.Data(), other.matrix_.Data(), rows_ * cols_);
+  return *this;
+}
+template <typename T, typename L>
+DynamicMatrix<T, L>& DynamicMatrix<T, L>::operator-=(
+    const DynamicMatrix& other) {
+  CheckSameShape(*this, other);
+  matrix_kernels::Sub(matrix_.Data(), other.matrix_.Data(), rows_ * cols_);
+  return *this;
+}
+template <typename T, typename L>
+DynamicMatrix<T, L>& DynamicMatrix<T, L>::operator*=(const T& mult) {
+  matrix_kernels::Scale(matrix_.Data(), mult, rows_ * cols_);
+  return *this;
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> operator*(const DynamicMatrix<T, L>& lhs,
+                              const DynamicMatrix<T, L>& rhs) {
+  if (lhs.Cols() != rhs.Rows()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  DynamicMatrix<T, L> res(lhs.Rows(), rhs.Cols());
+  LayoutGemm<L>(lhs.Rows(), lhs.Cols(), rhs.Cols(), lhs.Data(), rhs.Data(),
+                res.Data());
+  return res;
+}
+
+template <typename T, typename L>
+bool operator==(const DynamicMatrix<T, L>& lhs,
+                const DynamicMatrix<T, L>& rhs) {
+  return lhs.Rows() == rhs.Rows() and lhs.Cols() == rhs.Cols() and
+         matrix_kernels::Equal(lhs.Data(), rhs.Data(),
+                               lhs.Rows() * lhs.Cols());
+}
+template <typename T, typename L>
+bool operator!=(const DynamicMatrix<T, L>& lhs,
+                const DynamicMatrix<T, L>& rhs) {
+  return not(lhs == rhs);
+}
+
+#endif  // #ifndef DYNAMIC_MATRIX
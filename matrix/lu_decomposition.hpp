@@ -0,0 +1,250 @@
+#ifndef LU_DECOMPOSITION
+#define LU_DECOMPOSITION
+
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "aligned_buffer.hpp"
+#include "dynamic_matrix.hpp"
+#include "matrix.hpp"
+#include "matrix_expr.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// Columns factorized per panel. Everything to the right of a panel is
+// updated with one Gemm call per panel.
+const size_t kLuBlock = 64;
+
+struct SingularMatrix : public std::exception {
+  const char* what() const noexcept override { return "Matrix is singular"; }
+};
+
+// P A = L U with partial pivoting, stored in place in one column-major
+// buffer: L below the diagonal (its unit diagonal is implied), U on and
+// above it. Factorize once, then solve against as many right-hand sides as
+// needed.
+template <typename T>
+class LuDecomposition {
+  static_assert(std::is_floating_point_v<T>);
+
+ public:
+  template <typename E>
+  explicit LuDecomposition(const MatrixExpr<E>& matrix);
+
+  size_t Size() const { return size_; }
+  bool IsSingular() const { return singular_; }
+
+  T Determinant() const;
+
+  // Overwrites the column-major size x count block rhs with the solution of
+  // A x = rhs.
+  void SolveInPlace(size_t count, T* rhs, size_t ldb) const;
+
+  template <size_t N, size_t K, typename L>
+  Matrix<N, K, T, L> Solve(const Matrix<N, K, T, L>& rhs) const;
+  template <typename L>
+  DynamicMatrix<T, L> Solve(const DynamicMatrix<T, L>& rhs) const;
+
+ private:
+  void Factorize();
+  void FactorizePanel(size_t k0, size_t width);
+  void SwapRows(size_t lhs, size_t rhs);
+
+  T& At(size_t row, size_t col) { return lu_[row + col * size_]; }
+  const T& At(size_t row, size_t col) const { return lu_[row + col * size_]; }
+
+  size_t size_;
+  AlignedBuffer<T> lu_;
+  std::vector<size_t> pivots_;
+  bool odd_swaps_ = false;
+  bool singular_ = false;
+};
+
+template <typename T>
+template <typename E>
+LuDecomposition<T>::LuDecomposition(const MatrixExpr<E>& matrix)
+    : size_(matrix.Self().Rows()),
+      lu_(size_ * size_),
+      pivots_(size_) {
+  if (matrix.Self().Cols() != size_) {
+    throw std::invalid_argument("LU of a non-square matrix");
+  }
+  AssignExpr<ColumnMajor>(lu_.Data(), size_, size_, matrix.Self());
+  Factorize();
+}
+
+template <typename T>
+void LuDecomposition<T>::SwapRows(size_t lhs, size_t rhs) {
+  for (size_t j = 0; j < size_; ++j) {
+    std::swap(At(lhs, j), At(rhs, j));
+  }
+}
+
+// Unblocked elimination restricted to columns [k0, k0 + width). Row swaps
+// are applied to whole rows so that the stored factors stay consistent.
+template <typename T>
+void LuDecomposition<T>::FactorizePanel(size_t k0, size_t width) {
+  for (size_t j = k0; j < k0 + width; ++j) {
+    size_t pivot = j;
+    for (size_t i = j + 1; i < size_; ++i) {
+      if (std::abs(At(i, j)) > std::abs(At(pivot, j))) {
+        pivot = i;
+      }
+    }
+    pivots_[j] = pivot;
+    if (pivot != j) {
+      SwapRows(pivot, j);
+      odd_swaps_ = not odd_swaps_;
+    }
+    if (At(j, j) == T()) {
+      singular_ = true;
+      continue;
+    }
+    T inverse = T(1) / At(j, j);
+    for (size_t i = j + 1; i < size_; ++i) {
+      At(i, j) *= inverse;
+    }
+    for (size_t col = j + 1; col < k0 + width; ++col) {
+      T mult = At(j, col);
+      for (size_t i = j + 1; i < size_; ++i) {
+        At(i, col) -= At(i, j) * mult;
+      }
+    }
+  }
+}
+
+template <typename T>
+void LuDecomposition<T>::Factorize() {
+  AlignedBuffer<T> panel(size_ * kLuBlock);
+  for (size_t k0 = 0; k0 < size_; k0 += kLuBlock) {
+    size_t width = size_ - k0 < kLuBlock ? size_ - k0 : kLuBlock;
+    size_t end = k0 + width;
+    FactorizePanel(k0, width);
+    if (end == size_) {
+      break;
+    }
+
+    // U12 = L11^-1 A12.
+    for (size_t col = end; col < size_; ++col) {
+      for (size_t j = k0; j < end; ++j) {
+        T mult = At(j, col);
+        for (size_t i = j + 1; i < end; ++i) {
+          At(i, col) -= At(i, j) * mult;
+        }
+      }
+    }
+
+    // A22 -= L21 U12. Gemm only accumulates, so L21 is negated into panel.
+    size_t rest = size_ - end;
+    for (size_t j = 0; j < width; ++j) {
+      for (size_t i = 0; i < rest; ++i) {
+        panel[i + j * rest] = -At(end + i, k0 + j);
+      }
+    }
+    matrix_kernels::Gemm(rest, width, rest, panel.Data(), rest,
+                         &At(k0, end), size_, &At(end, end), size_);
+  }
+}
+
+template <typename T>
+T LuDecomposition<T>::Determinant() const {
+  if (singular_) {
+    return T();
+  }
+  T res = odd_swaps_ ? T(-1) : T(1);
+  for (size_t i = 0; i < size_; ++i) {
+    res *= At(i, i);
+  }
+  return res;
+}
+
+template <typename T>
+void LuDecomposition<T>::SolveInPlace(size_t count, T* rhs,
+                                      size_t ldb) const {
+  if (singular_) {
+    throw SingularMatrix();
+  }
+  for (size_t c = 0; c < count; ++c) {
+    T* x = rhs + c * ldb;
+    for (size_t i = 0; i < size_; ++i) {
+      std::swap(x[i], x[pivots_[i]]);
+    }
+    for (size_t j = 0; j < size_; ++j) {
+      const T* column = &At(0, j);
+      for (size_t i = j + 1; i < size_; ++i) {
+        x[i] -= column[i] * x[j];
+      }
+    }
+    for (size_t j = size_; j-- > 0;) {
+      const T* column = &At(0, j);
+      x[j] /= column[j];
+      for (size_t i = 0; i < j; ++i) {
+        x[i] -= column[i] * x[j];
+      }
+    }
+  }
+}
+
+template <typename T>
+template <size_t N, size_t K, typename L>
+Matrix<N, K, T, L> LuDecomposition<T>::Solve(
+    const Matrix<N, K, T, L>& rhs) const {
+  if (N != size_) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  Matrix<N, K, T> res = rhs;
+  SolveInPlace(K, res.Data(), N);
+  return res;
+}
+
+template <typename T>
+template <typename L>
+DynamicMatrix<T, L> LuDecomposition<T>::Solve(
+    const DynamicMatrix<T, L>& rhs) const {
+  if (rhs.Rows() != size_) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  DynamicMatrix<T, ColumnMajor> res = rhs;
+  SolveInPlace(res.Cols(), res.Data(), res.Rows());
+  return res;
+}
+
+template <size_t N, typename T, typename L>
+T Determinant(const Matrix<N, N, T, L>& matrix) {
+  return LuDecomposition<T>(matrix).Determinant();
+}
+
+template <typename T, typename L>
+T Determinant(const DynamicMatrix<T, L>& matrix) {
+  return LuDecomposition<T>(matrix).Determinant();
+}
+
+template <size_t N, typename T, typename L>
+Matrix<N, N, T, L> Inverse(const Matrix<N, N, T, L>& matrix) {
+  return LuDecomposition<T>(matrix).Solve(Matrix<N, N, T, L>::Identity());
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> Inverse(const DynamicMatrix<T, L>& matrix) {
+  return LuDecomposition<T>(matrix).Solve(
+      DynamicMatrix<T, L>::Identity(matrix.Rows()));
+}
+
+template <size_t N, size_t K, typename T, typename L>
+Matrix<N, K, T, L> Solve(const Matrix<N, N, T, L>& matrix,
+                         const Matrix<N, K, T, L>& rhs) {
+  return LuDecomposition<T>(matrix).Solve(rhs);
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> Solve(const DynamicMatrix<T, L>& matrix,
+                          const DynamicMatrix<T, L>& rhs) {
+  return LuDecomposition<T>(matrix).Solve(rhs);
+}
+
+#endif  // #ifndef LU_DECOMPOSITION
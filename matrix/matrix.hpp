@@ -4,56 +4,103 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-template <size_t N, size_t M, typename T = int64_t>
-class Matrix {
+#include "matrix_expr.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+template <size_t N, size_t M, typename T = int64_t, typename L = ColumnMajor>
+class Matrix : public MatrixExpr<Matrix<N, M, T, L>> {
  public:
-  Matrix() = default;
+  using ValueType = T;
+  using Layout = L;
+  static constexpr size_t kRows = N;
+  static constexpr size_t kCols = M;
+  static constexpr bool kIsLeaf = true;
+
+  constexpr Matrix() = default;
+
+  explicit Matrix(const std::vector<std::vector<T>>& matrix);
+  constexpr Matrix(std::initializer_list<std::initializer_list<T>> matrix);
+  constexpr explicit Matrix(const T& elem) { matrix_.fill(elem); }
+  template <typename E>
+  constexpr Matrix(const MatrixExpr<E>& expr) {
+    Assign(expr.Self());
+  }
 
-  explicit Matrix(std::vector<std::vector<T>> matrix);
-  explicit Matrix(const T& elem) { matrix_.fill(elem); }
+  static constexpr Matrix<N, M, T, L> Identity();
 
-  T& operator()(size_t height, size_t width) {
-    return matrix_[height + width * N];
-  };
-  const T& operator()(size_t height, size_t width) const {
-    return matrix_[height + width * N];
+  template <typename E>
+  constexpr Matrix& operator=(const MatrixExpr<E>& expr) {
+    Assign(expr.Self());
+    return *this;
   }
 
-  Matrix<M, N, T> Transposed();
-  T Trace();
+  constexpr T& operator()(size_t height, size_t width) {
+    return matrix_[Layout::Index(height, width, N, M)];
+  }
+  constexpr const T& operator()(size_t height, size_t width) const {
+    return matrix_[Layout::Index(height, width, N, M)];
+  }
 
-  bool operator==(Matrix<N, M, T> other);
-  bool operator!=(Matrix<N, M, T> other) { return not operator==(other); }
+  static constexpr size_t Rows() { return N; }
+  static constexpr size_t Cols() { return M; }
+  constexpr const T& Element(size_t idx) const { return matrix_[idx]; }
+  constexpr T* Data() { return matrix_.data(); }
+  constexpr const T* Data() const { return matrix_.data(); }
 
-  Matrix<N, M, T> operator+=(Matrix<N, M, T> other);
-  Matrix<N, M, T> operator-=(Matrix<N, M, T> other);
-  Matrix<N, M, T> operator*=(const T& mult);
+  constexpr Matrix<M, N, T, L> Transposed() const;
+  constexpr void Transpose();
+  constexpr T Trace() const;
+  constexpr Matrix<N, M, T, L> Pow(uint64_t exponent) const;
 
-  template <size_t K>
-  Matrix<N, K, T> operator*(Matrix<M, K, T> other);
+  constexpr Matrix<N, M, T, L>& operator+=(const Matrix<N, M, T, L>& other);
+  constexpr Matrix<N, M, T, L>& operator-=(const Matrix<N, M, T, L>& other);
+  constexpr Matrix<N, M, T, L>& operator*=(const T& mult);
 
-  Matrix<N, M, T> operator+(Matrix<N, M, T> other) {
-    other += *this;
-    return other;
+  template <typename E>
+  constexpr Matrix<N, M, T, L>& operator+=(const MatrixExpr<E>& expr) {
+    return *this = *this + expr.Self();
   }
-  Matrix<N, M, T> operator-(Matrix<N, M, T> other) {
-    other -= *this;
-    return other;
-  }
-  Matrix<N, M, T> operator*(const T& mult) {
-    Matrix<N, M, T> copy = *this;
-    copy *= mult;
-    return copy;
+  template <typename E>
+  constexpr Matrix<N, M, T, L>& operator-=(const MatrixExpr<E>& expr) {
+    return *this = *this - expr.Self();
   }
 
+  template <size_t K>
+  constexpr Matrix<N, K, T, L> operator*(const Matrix<M, K, T, L>& other) const;
+
  private:
-  std::array<T, N * M> matrix_{};
+  static constexpr void MultiplyInto(const Matrix<N, M, T, L>& lhs,
+                                     const Matrix<N, M, T, L>& rhs,
+                                     Matrix<N, M, T, L>& out);
+
+  template <typename E>
+  constexpr void Assign(const E& expr) {
+    CheckSameShape(*this, expr);
+    AssignExpr<Layout>(matrix_.data(), N, M, expr);
+  }
+
+  alignas(matrix_kernels::kAlignment) std::array<T, N * M> matrix_{};
 };
 
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T>::Matrix(std::vector<std::vector<T>> matrix) {
+template <typename Lhs, typename Rhs>
+  requires(IsStaticShape<Lhs, Rhs>())
+constexpr Matrix<Lhs::kRows, Rhs::kCols, typename Lhs::ValueType,
+                 typename Lhs::Layout>
+operator*(const MatrixExpr<Lhs>& lhs, const MatrixExpr<Rhs>& rhs) {
+  using ValueType = typename Lhs::ValueType;
+  using Layout = typename Lhs::Layout;
+  return Matrix<Lhs::kRows, Lhs::kCols, ValueType, Layout>(lhs) *
+         Matrix<Rhs::kRows, Rhs::kCols, ValueType, Layout>(rhs);
+}
+
+template <size_t N, size_t M, typename T, typename L>
+Matrix<N, M, T, L>::Matrix(const std::vector<std::vector<T>>& matrix) {
   for (size_t i = 0; i < N; ++i) {
     for (size_t j = 0; j < M; ++j) {
       operator()(i, j) = matrix[i][j];
@@ -61,70 +108,131 @@ Matrix<N, M, T>::Matrix(std::vector<std::vector<T>> matrix) {
   }
 }
 
-template <size_t N, size_t M, typename T>
-Matrix<M, N, T> Matrix<N, M, T>::Transposed() {
-  Matrix<M, N, T> transposed;
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < M; ++j) {
-      transposed(j, i) = operator()(i, j);
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L>::Matrix(
+    std::initializer_list<std::initializer_list<T>> matrix) {
+  size_t i = 0;
+  for (const auto& row : matrix) {
+    size_t j = 0;
+    for (const T& elem : row) {
+      operator()(i, j) = elem;
+      ++j;
     }
+    ++i;
   }
+}
+
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L> Matrix<N, M, T, L>::Identity() {
+  static_assert(N == M);
+  Matrix<N, M, T, L> identity;
+  for (size_t i = 0; i < N; ++i) {
+    identity(i, i) = T(1);
+  }
+  return identity;
+}
+
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<M, N, T, L> Matrix<N, M, T, L>::Transposed() const {
+  Matrix<M, N, T, L> transposed;
+  LayoutTranspose<Layout>(N, M, Data(), transposed.Data());
   return transposed;
 }
 
-template <size_t N, size_t M, typename T>
-T Matrix<N, M, T>::Trace() {
+template <size_t N, size_t M, typename T, typename L>
+constexpr void Matrix<N, M, T, L>::Transpose() {
   static_assert(N == M);
-  T res;
+  matrix_kernels::TransposeSquare(N, Data(), N);
+}
+
+template <size_t N, size_t M, typename T, typename L>
+constexpr T Matrix<N, M, T, L>::Trace() const {
+  static_assert(N == M);
+  T res{};
   for (size_t i = 0; i < N; ++i) {
     res += operator()(i, i);
   }
   return res;
 }
 
-template <size_t N, size_t M, typename T>
-bool Matrix<N, M, T>::operator==(Matrix<N, M, T> other) {
-  for (size_t i = 0; i < N * M; ++i) {
-    if (matrix_[i] != other.matrix_[i]) {
-      return false;
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L> Matrix<N, M, T, L>::Pow(uint64_t exponent) const {
+  static_assert(N == M);
+  Matrix<N, M, T, L> buffers[3] = {Identity(), *this, Matrix<N, M, T, L>()};
+  Matrix<N, M, T, L>* res = &buffers[0];
+  Matrix<N, M, T, L>* base = &buffers[1];
+  Matrix<N, M, T, L>* spare = &buffers[2];
+  for (; exponent != 0; exponent >>= 1) {
+    if ((exponent & 1) != 0) {
+      MultiplyInto(*res, *base, *spare);
+      std::swap(res, spare);
+    }
+    if (exponent > 1) {
+      MultiplyInto(*base, *base, *spare);
+      std::swap(base, spare);
     }
   }
-  return true;
+  return *res;
 }
 
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator+=(Matrix<N, M, T> other) {
-  for (size_t i = 0; i < N * M; ++i) {
-    matrix_[i] += other.matrix_[i];
+template <size_t N, size_t M, typename T, typename L>
+constexpr void Matrix<N, M, T, L>::MultiplyInto(const Matrix<N, M, T, L>& lhs,
+                                             const Matrix<N, M, T, L>& rhs,
+                                             Matrix<N, M, T, L>& out) {
+  out.matrix_.fill(T());
+  LayoutGemm<Layout>(N, N, N, lhs.Data(), rhs.Data(), out.Data());
+}
+
+template <size_t N, size_t M, typename T, typename L>
+constexpr bool operator==(const Matrix<N, M, T, L>& lhs,
+                          const Matrix<N, M, T, L>& rhs) {
+  if (std::is_constant_evaluated()) {
+    return matrix_kernels::Equal<T>(lhs.Data(), rhs.Data(), N * M);
+  }
+  return matrix_kernels::Equal(lhs.Data(), rhs.Data(), N * M);
+}
+template <size_t N, size_t M, typename T, typename L>
+constexpr bool operator!=(const Matrix<N, M, T, L>& lhs,
+                          const Matrix<N, M, T, L>& rhs) {
+  return not(lhs == rhs);
+}
+
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L>& Matrix<N, M, T, L>::operator+=(
+    const Matrix<N, M, T, L>& other) {
+  if (std::is_constant_evaluated()) {
+    matrix_kernels::Add<T>(matrix_.data(), other.matrix_.data(), N * M);
+  } else {
+    matrix_kernels::Add(matrix_.data(), other.matrix_.data(), N * M);
   }
   return *this;
 }
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator-=(Matrix<N, M, T> other) {
-  for (size_t i = 0; i < N * M; ++i) {
-    matrix_[i] -= other.matrix_[i];
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L>& Matrix<N, M, T, L>::operator-=(
+    const Matrix<N, M, T, L>& other) {
+  if (std::is_constant_evaluated()) {
+    matrix_kernels::Sub<T>(matrix_.data(), other.matrix_.data(), N * M);
+  } else {
+    matrix_kernels::Sub(matrix_.data(), other.matrix_.data(), N * M);
   }
   return *this;
 }
-template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator*=(const T& mult) {
-  for (size_t i = 0; i < N * M; ++i) {
-    matrix_[i] *= mult;
+template <size_t N, size_t M, typename T, typename L>
+constexpr Matrix<N, M, T, L>& Matrix<N, M, T, L>::operator*=(const T& mult) {
+  if (std::is_constant_evaluated()) {
+    matrix_kernels::Scale<T>(matrix_.data(), mult, N * M);
+  } else {
+    matrix_kernels::Scale(matrix_.data(), mult, N * M);
   }
   return *this;
 }
 
-template <size_t N, size_t M, typename T>
+template <size_t N, size_t M, typename T, typename L>
 template <size_t K>
-Matrix<N, K, T> Matrix<N, M, T>::operator*(Matrix<M, K, T> other) {
-  Matrix<N, K, T> res;
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < K; ++j) {
-      for (size_t k = 0; k < M; ++k) {
-        res(i, j) += operator()(i, k) * other(k, j);
-      }
-    }
-  }
+constexpr Matrix<N, K, T, L> Matrix<N, M, T, L>::operator*(
+    const Matrix<M, K, T, L>& other) const {
+  Matrix<N, K, T, L> res;
+  LayoutGemm<Layout>(N, M, K, Data(), other.Data(), res.Data());
   return res;
 }
 
@@ -0,0 +1,183 @@
+#ifndef MATRIX_BATCH
+#define MATRIX_BATCH
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include "aligned_buffer.hpp"
+#include "matrix.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// Batch sizes are rounded up to this many matrices, so every element run
+// starts aligned and the SIMD loops have no tail.
+const size_t kBatchLanes = 16;
+// Matrices processed per pass of a product, sized so that the runs of both
+// operands and the result stay in L1.
+const size_t kBatchChunk = 256;
+
+// Size() matrices of one shape in structure-of-arrays form: element (i, j)
+// of every matrix is stored in one contiguous run of Stride() values, so a
+// single SIMD instruction touches the same element of many matrices. Runs
+// follow the column-major order of Matrix. Padding matrices are kept zero.
+template <size_t N, size_t M, typename T = float>
+class MatrixBatch {
+ public:
+  using ValueType = T;
+  using Layout = ColumnMajor;
+
+  MatrixBatch() = default;
+  explicit MatrixBatch(size_t size)
+      : size_(size),
+        stride_((size + kBatchLanes - 1) / kBatchLanes * kBatchLanes),
+        matrix_(N * M * stride_) {}
+
+  size_t Size() const { return size_; }
+  size_t Stride() const { return stride_; }
+
+  T& operator()(size_t index, size_t row, size_t col) {
+    return Run(row, col)[index];
+  }
+  const T& operator()(size_t index, size_t row, size_t col) const {
+    return Run(row, col)[index];
+  }
+
+  T* Run(size_t row, size_t col) {
+    return matrix_.Data() + Layout::Index(row, col, N, M) * stride_;
+  }
+  const T* Run(size_t row, size_t col) const {
+    return matrix_.Data() + Layout::Index(row, col, N, M) * stride_;
+  }
+  T* Data() { return matrix_.Data(); }
+  const T* Data() const { return matrix_.Data(); }
+
+  Matrix<N, M, T> Get(size_t index) const;
+  void Set(size_t index, const Matrix<N, M, T>& matrix);
+
+  MatrixBatch<M, N, T> Transposed() const;
+
+  MatrixBatch& operator+=(const MatrixBatch& other);
+  MatrixBatch& operator-=(const MatrixBatch& other);
+  MatrixBatch& operator*=(const T& mult);
+
+ private:
+  void CheckSameSize(const MatrixBatch& other) const {
+    if (size_ != other.size_) {
+      throw std::invalid_argument("Batch sizes do not match");
+    }
+  }
+
+  size_t size_ = 0;
+  size_t stride_ = 0;
+  AlignedBuffer<T> matrix_;
+};
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> MatrixBatch<N, M, T>::Get(size_t index) const {
+  Matrix<N, M, T> res;
+  for (size_t j = 0; j < M; ++j) {
+    for (size_t i = 0; i < N; ++i) {
+      res(i, j) = (*this)(index, i, j);
+    }
+  }
+  return res;
+}
+
+template <size_t N, size_t M, typename T>
+void MatrixBatch<N, M, T>::Set(size_t index, const Matrix<N, M, T>& matrix) {
+  for (size_t j = 0; j < M; ++j) {
+    for (size_t i = 0; i < N; ++i) {
+      (*this)(index, i, j) = matrix(i, j);
+    }
+  }
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<M, N, T> MatrixBatch<N, M, T>::Transposed() const {
+  MatrixBatch<M, N, T> res(size_);
+  for (size_t j = 0; j < M; ++j) {
+    for (size_t i = 0; i < N; ++i) {
+      std::copy(Run(i, j), Run(i, j) + stride_, res.Run(j, i));
+    }
+  }
+  return res;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T>& MatrixBatch<N, M, T>::operator+=(
+    const MatrixBatch& other) {
+  CheckSameSize(other);
+  matrix_kernels::Add(Data(), other.Data(), N * M * stride_);
+  return *this;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T>& MatrixBatch<N, M, T>::operator-=(
+    const MatrixBatch& other) {
+  CheckSameSize(other);
+  matrix_kernels::Sub(Data(), other.Data(), N * M * stride_);
+  return *this;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T>& MatrixBatch<N, M, T>::operator*=(const T& mult) {
+  matrix_kernels::Scale(Data(), mult, N * M * stride_);
+  return *this;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T> operator+(MatrixBatch<N, M, T> lhs,
+                               const MatrixBatch<N, M, T>& rhs) {
+  return lhs += rhs;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T> operator-(MatrixBatch<N, M, T> lhs,
+                               const MatrixBatch<N, M, T>& rhs) {
+  return lhs -= rhs;
+}
+
+// Pairwise products: matrix i of the result is lhs[i] * rhs[i]. With K = 1
+// this is a batch of matrix-vector products.
+template <size_t N, size_t M, size_t K, typename T>
+MatrixBatch<N, K, T> operator*(const MatrixBatch<N, M, T>& lhs,
+                               const MatrixBatch<M, K, T>& rhs) {
+  if (lhs.Size() != rhs.Size()) {
+    throw std::invalid_argument("Batch sizes do not match");
+  }
+  MatrixBatch<N, K, T> res(lhs.Size());
+  for (size_t s = 0; s < res.Stride(); s += kBatchChunk) {
+    size_t lanes = std::min(kBatchChunk, res.Stride() - s);
+    for (size_t j = 0; j < K; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        for (size_t p = 0; p < M; ++p) {
+          matrix_kernels::MulAdd(res.Run(i, j) + s, lhs.Run(i, p) + s,
+                                 rhs.Run(p, j) + s, lanes);
+        }
+      }
+    }
+  }
+  return res;
+}
+
+// One matrix applied to every matrix (or vector, with K = 1) of a batch.
+template <size_t N, size_t M, size_t K, typename T, typename L>
+MatrixBatch<N, K, T> operator*(const Matrix<N, M, T, L>& lhs,
+                               const MatrixBatch<M, K, T>& rhs) {
+  MatrixBatch<N, K, T> res(rhs.Size());
+  for (size_t s = 0; s < res.Stride(); s += kBatchChunk) {
+    size_t lanes = std::min(kBatchChunk, res.Stride() - s);
+    for (size_t j = 0; j < K; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        for (size_t p = 0; p < M; ++p) {
+          matrix_kernels::AddScaled(res.Run(i, j) + s, lhs(i, p),
+                                    rhs.Run(p, j) + s, lanes);
+        }
+      }
+    }
+  }
+  return res;
+}
+
+#endif  // #ifndef MATRIX_BATCH
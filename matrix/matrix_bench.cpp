@@ -0,0 +1,175 @@
+// Throughput of the Matrix operations against naive reference loops.
+//
+//   g++ -std=c++20 -O2 matrix_bench.cpp -o matrix_bench
+//   ./matrix_bench [seconds per measurement] > results.csv
+//
+// Every row reports the best time over repeated runs of one operation.
+// Bytes count the minimum traffic: each operand read once and the result
+// written once.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+#include "matrix.hpp"
+
+namespace {
+
+double min_seconds = 0.2;
+
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename T>
+const char* TypeName();
+template <>
+const char* TypeName<int64_t>() {
+  return "int64_t";
+}
+template <>
+const char* TypeName<float>() {
+  return "float";
+}
+template <>
+const char* TypeName<double>() {
+  return "double";
+}
+
+// Best time of one call of func, repeating it until min_seconds elapse.
+template <typename F>
+double Measure(F&& func) {
+  using Clock = std::chrono::steady_clock;
+  double best = 1e300;
+  double total = 0;
+  size_t runs = 0;
+  while (total < min_seconds or runs < 3) {
+    Clock::time_point start = Clock::now();
+    func();
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    best = elapsed < best ? elapsed : best;
+    total += elapsed;
+    ++runs;
+  }
+  return best;
+}
+
+void Report(const char* op, const char* type, size_t size, const char* impl,
+            double seconds, double flops, double bytes) {
+  std::printf("%s,%s,%zu,%s,%.9f,%.3f,%.3f\n", op, type, size, impl, seconds,
+              flops / seconds * 1e-9, bytes / seconds * 1e-9);
+}
+
+template <size_t N, typename T>
+void Run() {
+  using Mat = Matrix<N, N, T>;
+  auto a = std::make_unique<Mat>();
+  auto b = std::make_unique<Mat>();
+  auto c = std::make_unique<Mat>();
+  auto t = std::make_unique<Mat>();
+  std::mt19937_64 rng(N);
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      (*a)(i, j) = static_cast<T>(rng() % 16);
+      (*b)(i, j) = static_cast<T>(rng() % 16);
+    }
+  }
+  const char* type = TypeName<T>();
+  const double kElems = double(N) * N;
+  const double kBytes = kElems * sizeof(T);
+
+  double secs = Measure([&] {
+    *c = *a * *b;
+    DoNotOptimize(*c);
+  });
+  Report("mul", type, N, "matrix", secs, 2 * kElems * N, 3 * kBytes);
+  secs = Measure([&] {
+    for (size_t j = 0; j < N; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        T sum = T();
+        for (size_t p = 0; p < N; ++p) {
+          sum += (*a)(i, p) * (*b)(p, j);
+        }
+        (*c)(i, j) = sum;
+      }
+    }
+    DoNotOptimize(*c);
+  });
+  Report("mul", type, N, "naive", secs, 2 * kElems * N, 3 * kBytes);
+
+  secs = Measure([&] {
+    *c = *a + *b;
+    DoNotOptimize(*c);
+  });
+  Report("add", type, N, "matrix", secs, kElems, 3 * kBytes);
+  secs = Measure([&] {
+    *c = *a;
+    *c += *b;
+    DoNotOptimize(*c);
+  });
+  Report("add_assign", type, N, "matrix", secs, kElems, 3 * kBytes);
+  secs = Measure([&] {
+    for (size_t j = 0; j < N; ++j) {
+      for (size_t i = 0; i < N; ++i) {
+        (*c)(i, j) = (*a)(i, j) + (*b)(i, j);
+      }
+    }
+    DoNotOptimize(*c);
+  });
+  Report("add", type, N, "naive", secs, kElems, 3 * kBytes);
+
+  secs = Measure([&] {
+    *t = a->Transposed();
+    DoNotOptimize(*t);
+  });
+  Report("transpose", type, N, "matrix", secs, 0, 2 * kBytes);
+  secs = Measure([&] {
+    a->Transpose();
+    DoNotOptimize(*a);
+  });
+  Report("transpose_in_place", type, N, "matrix", secs, 0, 2 * kBytes);
+  secs = Measure([&] {
+    for (size_t i = 0; i < N; ++i) {
+      for (size_t j = 0; j < N; ++j) {
+        (*t)(j, i) = (*a)(i, j);
+      }
+    }
+    DoNotOptimize(*t);
+  });
+  Report("transpose", type, N, "naive", secs, 0, 2 * kBytes);
+
+  secs = Measure([&] { DoNotOptimize(a->Trace()); });
+  Report("trace", type, N, "matrix", secs, N, N * sizeof(T));
+  secs = Measure([&] {
+    T sum = T();
+    for (size_t i = 0; i < N; ++i) {
+      sum += (*a)(i, i);
+    }
+    DoNotOptimize(sum);
+  });
+  Report("trace", type, N, "naive", secs, N, N * sizeof(T));
+}
+
+template <typename T, size_t... Sizes>
+void Sweep() {
+  (Run<Sizes, T>(), ...);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    min_seconds = std::atof(argv[1]);
+  }
+  std::printf("op,type,size,impl,seconds,gflops,gbytes_per_s\n");
+  Sweep<int64_t, 8, 32, 128, 512>();
+  Sweep<float, 8, 32, 128, 512>();
+  Sweep<double, 8, 32, 128, 512>();
+  return 0;
+}
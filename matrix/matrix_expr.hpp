@@ -0,0 +1,263 @@
+#ifndef MATRIX_EXPR
+#define MATRIX_EXPR
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "matrix_layout.hpp"
+
+const size_t kDynamicExtent = static_cast<size_t>(-1);
+
+template <typename Derived>
+class MatrixExpr {
+ public:
+  constexpr const Derived& Self() const {
+    return static_cast<const Derived&>(*this);
+  }
+};
+
+constexpr bool ExtentsMatch(size_t lhs, size_t rhs) {
+  return lhs == rhs or lhs == kDynamicExtent or rhs == kDynamicExtent;
+}
+
+constexpr size_t CommonExtent(size_t lhs, size_t rhs) {
+  return lhs == kDynamicExtent ? rhs : lhs;
+}
+
+template <typename Lhs, typename Rhs>
+constexpr bool IsStaticShape() {
+  return Lhs::kRows != kDynamicExtent and Lhs::kCols != kDynamicExtent and
+         Rhs::kRows != kDynamicExtent and Rhs::kCols != kDynamicExtent;
+}
+
+template <typename Lhs, typename Rhs>
+constexpr void CheckSameShape(const Lhs& lhs, const Rhs& rhs) {
+  static_assert(ExtentsMatch(Lhs::kRows, Rhs::kRows) and
+                ExtentsMatch(Lhs::kCols, Rhs::kCols));
+  if (lhs.Rows() != rhs.Rows() or lhs.Cols() != rhs.Cols()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+}
+
+// Reads element (row, col) of expr regardless of its layout.
+template <typename E>
+constexpr decltype(auto) ElementAt(const E& expr, size_t row, size_t col) {
+  return expr.Element(E::Layout::Index(row, col, expr.Rows(), expr.Cols()));
+}
+
+template <size_t N, size_t M, typename T, typename L>
+class Matrix;
+template <typename T, typename L>
+class DynamicMatrix;
+
+// The matrix an expression evaluates to.
+template <typename E>
+using MatrixExprResult =
+    std::conditional_t<E::kRows != kDynamicExtent and
+                           E::kCols != kDynamicExtent,
+                       Matrix<E::kRows, E::kCols, typename E::ValueType,
+                              typename E::Layout>,
+                       DynamicMatrix<typename E::ValueType,
+                                     typename E::Layout>>;
+
+// Base of the inner nodes: (i, j), Trace() and Transposed() work on an
+// expression as they do on a matrix.
+template <typename Derived>
+class MatrixExprNode : public MatrixExpr<Derived> {
+ public:
+  constexpr auto operator()(size_t row, size_t col) const {
+    return ElementAt(this->Self(), row, col);
+  }
+  // Does not compile for shapes known not to be square, and throws
+  // std::invalid_argument for a dynamic shape that is not.
+  constexpr auto Trace() const;
+  constexpr auto Transposed() const {
+    return MatrixExprResult<Derived>(this->Self()).Transposed();
+  }
+};
+
+template <typename Derived>
+constexpr auto MatrixExprNode<Derived>::Trace() const {
+  static_assert(ExtentsMatch(Derived::kRows, Derived::kCols));
+  const Derived& self = this->Self();
+  if (self.Rows() != self.Cols()) {
+    throw std::invalid_argument("Trace of a non-square matrix");
+  }
+  typename Derived::ValueType res{};
+  for (size_t i = 0; i < self.Rows(); ++i) {
+    res += ElementAt(self, i, i);
+  }
+  return res;
+}
+
+// Operands of +, - and scalar * are anything derived from MatrixExpr.
+template <typename X>
+concept MatrixExprOperand =
+    std::is_base_of_v<MatrixExpr<std::remove_cvref_t<X>>,
+                      std::remove_cvref_t<X>>;
+
+// How a node holds an operand passed as X: an lvalue leaf by reference, a
+// temporary leaf and every inner node by value. A node then never refers
+// to a temporary, so it can be stored and evaluated later.
+template <typename X>
+using MatrixExprStorage =
+    std::conditional_t<std::is_lvalue_reference_v<X> and
+                           std::remove_cvref_t<X>::kIsLeaf,
+                       const std::remove_cvref_t<X>&, std::remove_cvref_t<X>>;
+
+struct MatrixExprPlus {
+  template <typename T>
+  static constexpr T Apply(const T& lhs, const T& rhs) {
+    return lhs + rhs;
+  }
+};
+
+struct MatrixExprMinus {
+  template <typename T>
+  static constexpr T Apply(const T& lhs, const T& rhs) {
+    return lhs - rhs;
+  }
+};
+
+// Lhs and Rhs are MatrixExprStorage types.
+template <typename Lhs, typename Rhs, typename Op>
+class MatrixBinaryExpr
+    : public MatrixExprNode<MatrixBinaryExpr<Lhs, Rhs, Op>> {
+  using LhsExpr = std::remove_cvref_t<Lhs>;
+  using RhsExpr = std::remove_cvref_t<Rhs>;
+
+ public:
+  using ValueType = typename LhsExpr::ValueType;
+  using Layout = typename LhsExpr::Layout;
+  static constexpr size_t kRows = CommonExtent(LhsExpr::kRows, RhsExpr::kRows);
+  static constexpr size_t kCols = CommonExtent(LhsExpr::kCols, RhsExpr::kCols);
+  static constexpr bool kIsLeaf = false;
+
+  static_assert(std::is_same_v<ValueType, typename RhsExpr::ValueType>);
+  static_assert(std::is_same_v<Layout, typename RhsExpr::Layout>);
+
+  template <typename L, typename R>
+  constexpr MatrixBinaryExpr(L&& lhs, R&& rhs)
+      : lhs_(std::forward<L>(lhs)), rhs_(std::forward<R>(rhs)) {
+    CheckSameShape(lhs_, rhs_);
+  }
+
+  constexpr size_t Rows() const { return lhs_.Rows(); }
+  constexpr size_t Cols() const { return lhs_.Cols(); }
+  constexpr ValueType Element(size_t idx) const {
+    return Op::Apply(lhs_.Element(idx), rhs_.Element(idx));
+  }
+
+ private:
+  Lhs lhs_;
+  Rhs rhs_;
+};
+
+// E is a MatrixExprStorage type.
+template <typename E>
+class MatrixScaledExpr : public MatrixExprNode<MatrixScaledExpr<E>> {
+  using Expr = std::remove_cvref_t<E>;
+
+ public:
+  using ValueType = typename Expr::ValueType;
+  using Layout = typename Expr::Layout;
+  static constexpr size_t kRows = Expr::kRows;
+  static constexpr size_t kCols = Expr::kCols;
+  static constexpr bool kIsLeaf = false;
+
+  template <typename X>
+  constexpr MatrixScaledExpr(X&& expr, const ValueType& mult)
+      : expr_(std::forward<X>(expr)), mult_(mult) {}
+
+  constexpr size_t Rows() const { return expr_.Rows(); }
+  constexpr size_t Cols() const { return expr_.Cols(); }
+  constexpr ValueType Element(size_t idx) const {
+    return expr_.Element(idx) * mult_;
+  }
+
+ private:
+  E expr_;
+  ValueType mult_;
+};
+
+template <MatrixExprOperand Lhs, MatrixExprOperand Rhs>
+constexpr MatrixBinaryExpr<MatrixExprStorage<Lhs>, MatrixExprStorage<Rhs>,
+                           MatrixExprPlus>
+operator+(Lhs&& lhs, Rhs&& rhs) {
+  return {std::forward<Lhs>(lhs), std::forward<Rhs>(rhs)};
+}
+
+template <MatrixExprOperand Lhs, MatrixExprOperand Rhs>
+constexpr MatrixBinaryExpr<MatrixExprStorage<Lhs>, MatrixExprStorage<Rhs>,
+                           MatrixExprMinus>
+operator-(Lhs&& lhs, Rhs&& rhs) {
+  return {std::forward<Lhs>(lhs), std::forward<Rhs>(rhs)};
+}
+
+template <MatrixExprOperand E>
+constexpr MatrixScaledExpr<MatrixExprStorage<E>> operator*(
+    E&& expr, const typename std::remove_cvref_t<E>::ValueType& mult) {
+  return {std::forward<E>(expr), mult};
+}
+
+template <MatrixExprOperand E>
+constexpr MatrixScaledExpr<MatrixExprStorage<E>> operator*(
+    const typename std::remove_cvref_t<E>::ValueType& mult, E&& expr) {
+  return {std::forward<E>(expr), mult};
+}
+
+template <typename Lhs, typename Rhs>
+constexpr bool operator==(const MatrixExpr<Lhs>& lhs_expr,
+                          const MatrixExpr<Rhs>& rhs_expr) {
+  static_assert(ExtentsMatch(Lhs::kRows, Rhs::kRows) and
+                ExtentsMatch(Lhs::kCols, Rhs::kCols));
+  const Lhs& lhs = lhs_expr.Self();
+  const Rhs& rhs = rhs_expr.Self();
+  if (lhs.Rows() != rhs.Rows() or lhs.Cols() != rhs.Cols()) {
+    return false;
+  }
+  if constexpr (std::is_same_v<typename Lhs::Layout, typename Rhs::Layout>) {
+    for (size_t i = 0; i < lhs.Rows() * lhs.Cols(); ++i) {
+      if (lhs.Element(i) != rhs.Element(i)) {
+        return false;
+      }
+    }
+  } else {
+    for (size_t i = 0; i < lhs.Rows(); ++i) {
+      for (size_t j = 0; j < lhs.Cols(); ++j) {
+        if (ElementAt(lhs, i, j) != ElementAt(rhs, i, j)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <typename Lhs, typename Rhs>
+constexpr bool operator!=(const MatrixExpr<Lhs>& lhs,
+                          const MatrixExpr<Rhs>& rhs) {
+  return not(lhs == rhs);
+}
+
+// Writes expr into densely packed storage of the given shape and layout.
+template <typename Layout, typename T, typename E>
+constexpr void AssignExpr(T* dst, size_t rows, size_t cols, const E& expr) {
+  if constexpr (std::is_same_v<Layout, typename E::Layout>) {
+    for (size_t i = 0; i < rows * cols; ++i) {
+      dst[i] = expr.Element(i);
+    }
+  } else if constexpr (E::kIsLeaf) {
+    LayoutTranspose<typename E::Layout>(rows, cols, expr.Data(), dst);
+  } else {
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < cols; ++j) {
+        dst[Layout::Index(i, j, rows, cols)] = ElementAt(expr, i, j);
+      }
+    }
+  }
+}
+
+#endif  // #ifndef MATRIX_EXPR
@@ -0,0 +1,243 @@
+#ifndef MATRIX_IO
+#define MATRIX_IO
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "dynamic_matrix.hpp"
+#include "matrix_expr.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// File layout, native byte order:
+//   MatrixFileHeader, zero padding up to data_offset, then rows * cols
+//   elements densely packed in the stored layout.
+// data_offset is a multiple of the stored alignment, so a mapping of the
+// file (which starts on a page boundary) yields aligned data.
+struct MatrixFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t type_code;
+  uint32_t layout;
+  uint32_t alignment;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t data_offset;
+};
+
+const char kMatrixFileMagic[8] = {'C', 'P', 'P', 'M', 'A', 'T', 'X', '\0'};
+const uint32_t kMatrixFileVersion = 1;
+const uint64_t kMatrixFileDataOffset = 64;
+
+static_assert(sizeof(MatrixFileHeader) <= kMatrixFileDataOffset);
+static_assert(kMatrixFileDataOffset % matrix_kernels::kAlignment == 0);
+
+template <typename T>
+struct MatrixFileType;
+template <>
+struct MatrixFileType<int32_t> {
+  static const uint32_t kCode = 1;
+};
+template <>
+struct MatrixFileType<int64_t> {
+  static const uint32_t kCode = 2;
+};
+template <>
+struct MatrixFileType<uint64_t> {
+  static const uint32_t kCode = 3;
+};
+template <>
+struct MatrixFileType<float> {
+  static const uint32_t kCode = 4;
+};
+template <>
+struct MatrixFileType<double> {
+  static const uint32_t kCode = 5;
+};
+
+template <typename Layout>
+constexpr uint32_t MatrixFileLayout() {
+  return std::is_same_v<Layout, RowMajor> ? 1 : 0;
+}
+
+struct MatrixFileError : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+namespace matrix_io_detail {
+
+inline void WriteAll(int fd, const void* data, size_t size) {
+  const char* ptr = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = ::write(fd, ptr, size);
+    if (written < 0) {
+      throw MatrixFileError("Failed to write matrix file");
+    }
+    ptr += written;
+    size -= written;
+  }
+}
+
+template <typename T, typename Layout>
+void Save(const std::string& path, size_t rows, size_t cols, const T* data) {
+  MatrixFileHeader header{};
+  std::memcpy(header.magic, kMatrixFileMagic, sizeof(header.magic));
+  header.version = kMatrixFileVersion;
+  header.type_code = MatrixFileType<T>::kCode;
+  header.layout = MatrixFileLayout<Layout>();
+  header.alignment = matrix_kernels::kAlignment;
+  header.rows = rows;
+  header.cols = cols;
+  header.data_offset = kMatrixFileDataOffset;
+
+  char prefix[kMatrixFileDataOffset] = {};
+  std::memcpy(prefix, &header, sizeof(header));
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw MatrixFileError("Failed to open " + path);
+  }
+  try {
+    WriteAll(fd, prefix, sizeof(prefix));
+    WriteAll(fd, data, rows * cols * sizeof(T));
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+}  // namespace matrix_io_detail
+
+// Writes expr to path. Matrices are written straight from their storage;
+// other expressions are evaluated first.
+template <typename E>
+void SaveMatrix(const std::string& path, const MatrixExpr<E>& expr) {
+  using T = typename E::ValueType;
+  using Layout = typename E::Layout;
+  const E& matrix = expr.Self();
+  if constexpr (E::kIsLeaf) {
+    matrix_io_detail::Save<T, Layout>(path, matrix.Rows(), matrix.Cols(),
+                                      matrix.Data());
+  } else {
+    DynamicMatrix<T, Layout> evaluated = matrix;
+    matrix_io_detail::Save<T, Layout>(path, evaluated.Rows(),
+                                      evaluated.Cols(), evaluated.Data());
+  }
+}
+
+// Read-only view of a matrix file. The file is mapped, not read: pages are
+// loaded on first touch and shared with the page cache. Use it in matrix
+// expressions, or convert it to Matrix / DynamicMatrix to get a copy.
+template <typename T, typename L = ColumnMajor>
+class MappedMatrix : public MatrixExpr<MappedMatrix<T, L>> {
+ public:
+  using ValueType = T;
+  using Layout = L;
+  static constexpr size_t kRows = kDynamicExtent;
+  static constexpr size_t kCols = kDynamicExtent;
+  static constexpr bool kIsLeaf = true;
+
+  explicit MappedMatrix(const std::string& path);
+  MappedMatrix(const MappedMatrix&) = delete;
+  MappedMatrix& operator=(const MappedMatrix&) = delete;
+  MappedMatrix(MappedMatrix&& other) noexcept { Swap(other); }
+  MappedMatrix& operator=(MappedMatrix&& other) noexcept {
+    Swap(other);
+    return *this;
+  }
+  ~MappedMatrix();
+
+  const T& operator()(size_t height, size_t width) const {
+    return data_[Layout::Index(height, width, rows_, cols_)];
+  }
+
+  size_t Rows() const { return rows_; }
+  size_t Cols() const { return cols_; }
+  const T& Element(size_t idx) const { return data_[idx]; }
+  const T* Data() const { return data_; }
+
+  void Swap(MappedMatrix& other) noexcept;
+
+ private:
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  const T* data_ = nullptr;
+};
+
+template <typename T, typename L>
+MappedMatrix<T, L>::MappedMatrix(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw MatrixFileError("Failed to open " + path);
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0 or
+      static_cast<size_t>(info.st_size) < kMatrixFileDataOffset) {
+    ::close(fd);
+    throw MatrixFileError("Not a matrix file: " + path);
+  }
+  mapping_size_ = info.st_size;
+  mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    throw MatrixFileError("Failed to map " + path);
+  }
+
+  MatrixFileHeader header;
+  std::memcpy(&header, mapping_, sizeof(header));
+  const char* error = nullptr;
+  if (std::memcmp(header.magic, kMatrixFileMagic, sizeof(header.magic)) != 0 or
+      header.version != kMatrixFileVersion) {
+    error = "Not a matrix file: ";
+  } else if (header.type_code != MatrixFileType<T>::kCode) {
+    error = "Element type does not match: ";
+  } else if (header.layout != MatrixFileLayout<L>()) {
+    error = "Layout does not match: ";
+  } else if (header.data_offset % alignof(T) != 0 or
+             header.data_offset > mapping_size_ or
+             (header.cols != 0 and
+              header.rows > (mapping_size_ - header.data_offset) /
+                                sizeof(T) / header.cols)) {
+    error = "Truncated matrix file: ";
+  }
+  if (error != nullptr) {
+    ::munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    throw MatrixFileError(error + path);
+  }
+  rows_ = header.rows;
+  cols_ = header.cols;
+  data_ = reinterpret_cast<const T*>(static_cast<const char*>(mapping_) +
+                                     header.data_offset);
+}
+
+template <typename T, typename L>
+MappedMatrix<T, L>::~MappedMatrix() {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapping_size_);
+  }
+}
+
+template <typename T, typename L>
+void MappedMatrix<T, L>::Swap(MappedMatrix& other) noexcept {
+  std::swap(mapping_, other.mapping_);
+  std::swap(mapping_size_, other.mapping_size_);
+  std::swap(rows_, other.rows_);
+  std::swap(cols_, other.cols_);
+  std::swap(data_, other.data_);
+}
+
+#endif  // #ifndef MATRIX_IO
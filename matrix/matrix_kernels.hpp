@@ -0,0 +1,646 @@
+#ifndef MATRIX_KERNELS
+#define MATRIX_KERNELS
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MATRIX_KERNELS_X86
+#define MATRIX_KERNELS_AVX2 __attribute__((target("avx2,fma")))
+#define MATRIX_KERNELS_AVX2_ENTRY __attribute__((target("avx2,fma"), flatten))
+#endif
+
+namespace matrix_kernels {
+
+const size_t kAlignment = 32;
+
+const size_t kGemmBlockInner = 256;
+const size_t kGemmBlockRows = 96;
+const size_t kGemmKernelCols = 4;
+
+const size_t kTransposeBlock = 16;
+
+// Scalar fallbacks for every T. They are constexpr so that callers can name
+// them explicitly (Add<T>) during constant evaluation, where the SIMD
+// overloads below are unavailable.
+template <typename T>
+constexpr void Add(T* dst, const T* src, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] += src[i];
+  }
+}
+
+template <typename T>
+constexpr void Sub(T* dst, const T* src, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] -= src[i];
+  }
+}
+
+template <typename T>
+constexpr void Scale(T* dst, const T& mult, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] *= mult;
+  }
+}
+
+// dst[i] += lhs[i] * rhs[i].
+template <typename T>
+constexpr void MulAdd(T* dst, const T* lhs, const T* rhs, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] += lhs[i] * rhs[i];
+  }
+}
+
+// dst[i] += mult * src[i].
+template <typename T>
+constexpr void AddScaled(T* dst, const T& mult, const T* src, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] += mult * src[i];
+  }
+}
+
+template <typename T>
+constexpr bool Equal(const T* lhs, const T* rhs, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if (lhs[i] != rhs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Dot product of a sparse vector, given as values at indices, with the
+// dense vector x.
+template <typename T>
+constexpr T SparseDot(const T* values, const size_t* indices, const T* x,
+                      size_t size) {
+  T res = T();
+  for (size_t i = 0; i < size; ++i) {
+    res += values[i] * x[indices[i]];
+  }
+  return res;
+}
+
+// Column-major dst = src^T for a rows x cols src. The longer side is halved
+// until a block is small enough, so every level of the cache hierarchy sees
+// a tile that fits without the tile size being tuned for any of them.
+template <typename T>
+constexpr void Transpose(size_t rows, size_t cols, const T* src, size_t lds,
+                         T* dst, size_t ldd) {
+  if (rows <= kTransposeBlock and cols <= kTransposeBlock) {
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < cols; ++j) {
+        dst[j + i * ldd] = src[i + j * lds];
+      }
+    }
+  } else if (rows >= cols) {
+    size_t half = rows / 2;
+    Transpose(half, cols, src, lds, dst, ldd);
+    Transpose(rows - half, cols, src + half, lds, dst + half * ldd, ldd);
+  } else {
+    size_t half = cols / 2;
+    Transpose(rows, half, src, lds, dst, ldd);
+    Transpose(rows, cols - half, src + half * lds, lds, dst + half, ldd);
+  }
+}
+
+// Exchanges the rows x cols block x with the transpose of the cols x rows
+// block y.
+template <typename T>
+constexpr void SwapTransposed(size_t rows, size_t cols, T* x, size_t ldx,
+                              T* y, size_t ldy) {
+  if (rows <= kTransposeBlock and cols <= kTransposeBlock) {
+    for (size_t j = 0; j < cols; ++j) {
+      for (size_t i = 0; i < rows; ++i) {
+        T tmp = x[i + j * ldx];
+        x[i + j * ldx] = y[j + i * ldy];
+        y[j + i * ldy] = tmp;
+      }
+    }
+  } else if (rows >= cols) {
+    size_t half = rows / 2;
+    SwapTransposed(half, cols, x, ldx, y, ldy);
+    SwapTransposed(rows - half, cols, x + half, ldx, y + half * ldy, ldy);
+  } else {
+    size_t half = cols / 2;
+    SwapTransposed(rows, half, x, ldx, y, ldy);
+    SwapTransposed(rows, cols - half, x + half * ldx, ldx, y + half, ldy);
+  }
+}
+
+// In-place transpose of the n x n block a: the diagonal quadrants are
+// transposed recursively and the off-diagonal ones swapped with each other.
+template <typename T>
+constexpr void TransposeSquare(size_t n, T* a, size_t lda) {
+  if (n <= kTransposeBlock) {
+    for (size_t j = 0; j < n; ++j) {
+      for (size_t i = j + 1; i < n; ++i) {
+        T tmp = a[i + j * lda];
+        a[i + j * lda] = a[j + i * lda];
+        a[j + i * lda] = tmp;
+      }
+    }
+    return;
+  }
+  size_t half = n / 2;
+  TransposeSquare(half, a, lda);
+  TransposeSquare(n - half, a + half + half * lda, lda);
+  SwapTransposed(n - half, half, a + half, lda, a + half * lda, lda);
+}
+
+// Element types with a better product than the scalar loop specialize
+// GemmKernel instead of overloading Gemm, so the specialization is picked up
+// wherever it is declared relative to this header.
+template <typename T>
+struct GemmKernel {
+  static constexpr void Run(size_t n, size_t m, size_t k, const T* a,
+                            size_t lda, const T* b, size_t ldb, T* c,
+                            size_t ldc) {
+    for (size_t j = 0; j < k; ++j) {
+      for (size_t p = 0; p < m; ++p) {
+        const T& mult = b[p + j * ldb];
+        for (size_t i = 0; i < n; ++i) {
+          c[i + j * ldc] += a[i + p * lda] * mult;
+        }
+      }
+    }
+  }
+};
+
+// Column-major c += a * b, where a is n x m, b is m x k and ld* are the
+// distances between neighbouring columns.
+template <typename T>
+constexpr void Gemm(size_t n, size_t m, size_t k, const T* a, size_t lda,
+                    const T* b, size_t ldb, T* c, size_t ldc) {
+  GemmKernel<T>::Run(n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+#ifdef MATRIX_KERNELS_X86
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace detail {
+
+inline bool HasAvx2() {
+  static const bool kHasAvx2 =
+      __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+  return kHasAvx2;
+}
+
+struct Sse2Double {
+  using Type = double;
+  using Reg = __m128d;
+  static const size_t kLanes = 2;
+  static Reg Load(const double* ptr) { return _mm_loadu_pd(ptr); }
+  static void Store(double* ptr, Reg reg) { _mm_storeu_pd(ptr, reg); }
+  static Reg Broadcast(double val) { return _mm_set1_pd(val); }
+  static Reg Add(Reg lhs, Reg rhs) { return _mm_add_pd(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return _mm_sub_pd(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) { return _mm_mul_pd(lhs, rhs); }
+  static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return _mm_add_pd(acc, _mm_mul_pd(lhs, rhs));
+  }
+  static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm_movemask_pd(_mm_cmpeq_pd(lhs, rhs)) == 0x3;
+  }
+};
+
+struct Sse2Float {
+  using Type = float;
+  using Reg = __m128;
+  static const size_t kLanes = 4;
+  static Reg Load(const float* ptr) { return _mm_loadu_ps(ptr); }
+  static void Store(float* ptr, Reg reg) { _mm_storeu_ps(ptr, reg); }
+  static Reg Broadcast(float val) { return _mm_set1_ps(val); }
+  static Reg Add(Reg lhs, Reg rhs) { return _mm_add_ps(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return _mm_sub_ps(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) { return _mm_mul_ps(lhs, rhs); }
+  static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return _mm_add_ps(acc, _mm_mul_ps(lhs, rhs));
+  }
+  static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm_movemask_ps(_mm_cmpeq_ps(lhs, rhs)) == 0xF;
+  }
+};
+
+struct Sse2Int64 {
+  using Type = int64_t;
+  using Reg = __m128i;
+  static const size_t kLanes = 2;
+  static Reg Load(const int64_t* ptr) {
+    return _mm_loadu_si128(reinterpret_cast<const Reg*>(ptr));
+  }
+  static void Store(int64_t* ptr, Reg reg) {
+    _mm_storeu_si128(reinterpret_cast<Reg*>(ptr), reg);
+  }
+  static Reg Broadcast(int64_t val) { return _mm_set1_epi64x(val); }
+  static Reg Add(Reg lhs, Reg rhs) { return _mm_add_epi64(lhs, rhs); }
+  static Reg Sub(Reg lhs, Reg rhs) { return _mm_sub_epi64(lhs, rhs); }
+  static Reg Mul(Reg lhs, Reg rhs) {
+    Reg cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(lhs, 32), rhs),
+                              _mm_mul_epu32(lhs, _mm_srli_epi64(rhs, 32)));
+    return _mm_add_epi64(_mm_mul_epu32(lhs, rhs), _mm_slli_epi64(cross, 32));
+  }
+  static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return Add(acc, Mul(lhs, rhs));
+  }
+  static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) == 0xFFFF;
+  }
+};
+
+struct Avx2Double {
+  using Type = double;
+  using Reg = __m256d;
+  static const size_t kLanes = 4;
+  MATRIX_KERNELS_AVX2 static Reg Load(const double* ptr) {
+    return _mm256_loadu_pd(ptr);
+  }
+  MATRIX_KERNELS_AVX2 static void Store(double* ptr, Reg reg) {
+    _mm256_storeu_pd(ptr, reg);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Broadcast(double val) {
+    return _mm256_set1_pd(val);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Add(Reg lhs, Reg rhs) {
+    return _mm256_add_pd(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Sub(Reg lhs, Reg rhs) {
+    return _mm256_sub_pd(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Mul(Reg lhs, Reg rhs) {
+    return _mm256_mul_pd(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return _mm256_fmadd_pd(lhs, rhs, acc);
+  }
+  MATRIX_KERNELS_AVX2 static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(lhs, rhs, _CMP_EQ_OQ)) == 0xF;
+  }
+};
+
+struct Avx2Float {
+  using Type = float;
+  using Reg = __m256;
+  static const size_t kLanes = 8;
+  MATRIX_KERNELS_AVX2 static Reg Load(const float* ptr) {
+    return _mm256_loadu_ps(ptr);
+  }
+  MATRIX_KERNELS_AVX2 static void Store(float* ptr, Reg reg) {
+    _mm256_storeu_ps(ptr, reg);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Broadcast(float val) {
+    return _mm256_set1_ps(val);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Add(Reg lhs, Reg rhs) {
+    return _mm256_add_ps(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Sub(Reg lhs, Reg rhs) {
+    return _mm256_sub_ps(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Mul(Reg lhs, Reg rhs) {
+    return _mm256_mul_ps(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return _mm256_fmadd_ps(lhs, rhs, acc);
+  }
+  MATRIX_KERNELS_AVX2 static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(lhs, rhs, _CMP_EQ_OQ)) == 0xFF;
+  }
+};
+
+struct Avx2Int64 {
+  using Type = int64_t;
+  using Reg = __m256i;
+  static const size_t kLanes = 4;
+  MATRIX_KERNELS_AVX2 static Reg Load(const int64_t* ptr) {
+    return _mm256_loadu_si256(reinterpret_cast<const Reg*>(ptr));
+  }
+  MATRIX_KERNELS_AVX2 static void Store(int64_t* ptr, Reg reg) {
+    _mm256_storeu_si256(reinterpret_cast<Reg*>(ptr), reg);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Broadcast(int64_t val) {
+    return _mm256_set1_epi64x(val);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Add(Reg lhs, Reg rhs) {
+    return _mm256_add_epi64(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Sub(Reg lhs, Reg rhs) {
+    return _mm256_sub_epi64(lhs, rhs);
+  }
+  MATRIX_KERNELS_AVX2 static Reg Mul(Reg lhs, Reg rhs) {
+    Reg cross =
+        _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(lhs, 32), rhs),
+                         _mm256_mul_epu32(lhs, _mm256_srli_epi64(rhs, 32)));
+    return _mm256_add_epi64(_mm256_mul_epu32(lhs, rhs),
+                            _mm256_slli_epi64(cross, 32));
+  }
+  MATRIX_KERNELS_AVX2 static Reg MulAdd(Reg acc, Reg lhs, Reg rhs) {
+    return Add(acc, Mul(lhs, rhs));
+  }
+  MATRIX_KERNELS_AVX2 static bool AllEqual(Reg lhs, Reg rhs) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi64(lhs, rhs)) == -1;
+  }
+};
+
+template <typename V>
+inline void AddVec(typename V::Type* dst, const typename V::Type* src,
+                   size_t size) {
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    V::Store(dst + i, V::Add(V::Load(dst + i), V::Load(src + i)));
+  }
+  for (; i < size; ++i) {
+    dst[i] += src[i];
+  }
+}
+
+template <typename V>
+inline void SubVec(typename V::Type* dst, const typename V::Type* src,
+                   size_t size) {
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    V::Store(dst + i, V::Sub(V::Load(dst + i), V::Load(src + i)));
+  }
+  for (; i < size; ++i) {
+    dst[i] -= src[i];
+  }
+}
+
+template <typename V>
+inline void ScaleVec(typename V::Type* dst, typename V::Type mult,
+                     size_t size) {
+  typename V::Reg vmult = V::Broadcast(mult);
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    V::Store(dst + i, V::Mul(V::Load(dst + i), vmult));
+  }
+  for (; i < size; ++i) {
+    dst[i] *= mult;
+  }
+}
+
+template <typename V>
+inline void MulAddVec(typename V::Type* dst, const typename V::Type* lhs,
+                      const typename V::Type* rhs, size_t size) {
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    V::Store(dst + i,
+             V::MulAdd(V::Load(dst + i), V::Load(lhs + i), V::Load(rhs + i)));
+  }
+  for (; i < size; ++i) {
+    dst[i] += lhs[i] * rhs[i];
+  }
+}
+
+template <typename V>
+inline void AddScaledVec(typename V::Type* dst, typename V::Type mult,
+                         const typename V::Type* src, size_t size) {
+  typename V::Reg vmult = V::Broadcast(mult);
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    V::Store(dst + i, V::MulAdd(V::Load(dst + i), vmult, V::Load(src + i)));
+  }
+  for (; i < size; ++i) {
+    dst[i] += mult * src[i];
+  }
+}
+
+template <typename V>
+inline bool EqualVec(const typename V::Type* lhs, const typename V::Type* rhs,
+                     size_t size) {
+  size_t full = size - size % V::kLanes;
+  size_t i = 0;
+  for (; i < full; i += V::kLanes) {
+    if (not V::AllEqual(V::Load(lhs + i), V::Load(rhs + i))) {
+      return false;
+    }
+  }
+  for (; i < size; ++i) {
+    if (lhs[i] != rhs[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Keeps a (2 * kLanes) x kGemmKernelCols block of c in registers while
+// streaming over the inner dimension.
+template <typename V>
+inline void GemmMicroKernel(size_t m, const typename V::Type* a, size_t lda,
+                            const typename V::Type* b, size_t ldb,
+                            typename V::Type* c, size_t ldc) {
+  using Reg = typename V::Reg;
+  Reg acc[2][kGemmKernelCols];
+  for (size_t j = 0; j < kGemmKernelCols; ++j) {
+    acc[0][j] = V::Load(c + j * ldc);
+    acc[1][j] = V::Load(c + j * ldc + V::kLanes);
+  }
+  for (size_t p = 0; p < m; ++p) {
+    Reg lo = V::Load(a + p * lda);
+    Reg hi = V::Load(a + p * lda + V::kLanes);
+    for (size_t j = 0; j < kGemmKernelCols; ++j) {
+      Reg mult = V::Broadcast(b[p + j * ldb]);
+      acc[0][j] = V::MulAdd(acc[0][j], lo, mult);
+      acc[1][j] = V::MulAdd(acc[1][j], hi, mult);
+    }
+  }
+  for (size_t j = 0; j < kGemmKernelCols; ++j) {
+    V::Store(c + j * ldc, acc[0][j]);
+    V::Store(c + j * ldc + V::kLanes, acc[1][j]);
+  }
+}
+
+template <typename V>
+inline void GemmVec(size_t n, size_t m, size_t k, const typename V::Type* a,
+                    size_t lda, const typename V::Type* b, size_t ldb,
+                    typename V::Type* c, size_t ldc) {
+  const size_t kRowStep = 2 * V::kLanes;
+  size_t full_cols = k - k % kGemmKernelCols;
+  for (size_t p0 = 0; p0 < m; p0 += kGemmBlockInner) {
+    size_t inner = m - p0 < kGemmBlockInner ? m - p0 : kGemmBlockInner;
+    for (size_t i0 = 0; i0 < n; i0 += kGemmBlockRows) {
+      size_t rows = n - i0 < kGemmBlockRows ? n - i0 : kGemmBlockRows;
+      size_t full_rows = rows - rows % kRowStep;
+      const typename V::Type* a_block = a + i0 + p0 * lda;
+      for (size_t j = 0; j < full_cols; j += kGemmKernelCols) {
+        for (size_t i = 0; i < full_rows; i += kRowStep) {
+          GemmMicroKernel<V>(inner, a_block + i, lda, b + p0 + j * ldb, ldb,
+                             c + i0 + i + j * ldc, ldc);
+        }
+      }
+      Gemm(rows - full_rows, inner, full_cols, a_block + full_rows, lda,
+           b + p0, ldb, c + i0 + full_rows, ldc);
+      Gemm(rows, inner, k - full_cols, a_block, lda, b + p0 + full_cols * ldb,
+           ldb, c + i0 + full_cols * ldc, ldc);
+    }
+  }
+}
+
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void AddAvx2(typename V::Type* dst,
+                                 const typename V::Type* src, size_t size) {
+  AddVec<V>(dst, src, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void SubAvx2(typename V::Type* dst,
+                                 const typename V::Type* src, size_t size) {
+  SubVec<V>(dst, src, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void ScaleAvx2(typename V::Type* dst,
+                                   typename V::Type mult, size_t size) {
+  ScaleVec<V>(dst, mult, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void MulAddAvx2(typename V::Type* dst,
+                                          const typename V::Type* lhs,
+                                          const typename V::Type* rhs,
+                                          size_t size) {
+  MulAddVec<V>(dst, lhs, rhs, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void AddScaledAvx2(typename V::Type* dst,
+                                             typename V::Type mult,
+                                             const typename V::Type* src,
+                                             size_t size) {
+  AddScaledVec<V>(dst, mult, src, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY bool EqualAvx2(const typename V::Type* lhs,
+                                   const typename V::Type* rhs, size_t size) {
+  return EqualVec<V>(lhs, rhs, size);
+}
+template <typename V>
+MATRIX_KERNELS_AVX2_ENTRY void GemmAvx2(size_t n, size_t m, size_t k,
+                                  const typename V::Type* a, size_t lda,
+                                  const typename V::Type* b, size_t ldb,
+                                  typename V::Type* c, size_t ldc) {
+  GemmVec<V>(n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+#ifdef __x86_64__
+
+MATRIX_KERNELS_AVX2 inline double SparseDotAvx2(const double* values,
+                                                const size_t* indices,
+                                                const double* x, size_t size) {
+  __m256d acc = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+    acc = _mm256_fmadd_pd(_mm256_loadu_pd(values + i),
+                          _mm256_i64gather_pd(x, idx, sizeof(double)), acc);
+  }
+  __m128d sum =
+      _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  double res = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+  for (; i < size; ++i) {
+    res += values[i] * x[indices[i]];
+  }
+  return res;
+}
+
+MATRIX_KERNELS_AVX2 inline float SparseDotAvx2(const float* values,
+                                               const size_t* indices,
+                                               const float* x, size_t size) {
+  __m128 acc = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m256i idx =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+    acc = _mm_fmadd_ps(_mm_loadu_ps(values + i),
+                       _mm256_i64gather_ps(x, idx, sizeof(float)), acc);
+  }
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  float res = _mm_cvtss_f32(_mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1)));
+  for (; i < size; ++i) {
+    res += values[i] * x[indices[i]];
+  }
+  return res;
+}
+
+#endif  // #ifdef __x86_64__
+
+}  // namespace detail
+
+#define MATRIX_KERNELS_DISPATCH(TYPE, SSE, AVX)                               \
+  inline void Add(TYPE* dst, const TYPE* src, size_t size) {                  \
+    detail::HasAvx2() ? detail::AddAvx2<detail::AVX>(dst, src, size)          \
+                      : detail::AddVec<detail::SSE>(dst, src, size);          \
+  }                                                                           \
+  inline void Sub(TYPE* dst, const TYPE* src, size_t size) {                  \
+    detail::HasAvx2() ? detail::SubAvx2<detail::AVX>(dst, src, size)          \
+                      : detail::SubVec<detail::SSE>(dst, src, size);          \
+  }                                                                           \
+  inline void Scale(TYPE* dst, const TYPE& mult, size_t size) {               \
+    detail::HasAvx2() ? detail::ScaleAvx2<detail::AVX>(dst, mult, size)       \
+                      : detail::ScaleVec<detail::SSE>(dst, mult, size);       \
+  }                                                                           \
+  inline void MulAdd(TYPE* dst, const TYPE* lhs, const TYPE* rhs,             \
+                     size_t size) {                                           \
+    detail::HasAvx2() ? detail::MulAddAvx2<detail::AVX>(dst, lhs, rhs, size)  \
+                      : detail::MulAddVec<detail::SSE>(dst, lhs, rhs, size);  \
+  }                                                                           \
+  inline void AddScaled(TYPE* dst, const TYPE& mult, const TYPE* src,         \
+                        size_t size) {                                        \
+    detail::HasAvx2()                                                         \
+        ? detail::AddScaledAvx2<detail::AVX>(dst, mult, src, size)            \
+        : detail::AddScaledVec<detail::SSE>(dst, mult, src, size);            \
+  }                                                                           \
+  inline bool Equal(const TYPE* lhs, const TYPE* rhs, size_t size) {          \
+    return detail::HasAvx2() ? detail::EqualAvx2<detail::AVX>(lhs, rhs, size) \
+                             : detail::EqualVec<detail::SSE>(lhs, rhs, size); \
+  }
+
+MATRIX_KERNELS_DISPATCH(double, Sse2Double, Avx2Double)
+MATRIX_KERNELS_DISPATCH(float, Sse2Float, Avx2Float)
+MATRIX_KERNELS_DISPATCH(int64_t, Sse2Int64, Avx2Int64)
+
+#undef MATRIX_KERNELS_DISPATCH
+
+inline void Gemm(size_t n, size_t m, size_t k, const double* a, size_t lda,
+                 const double* b, size_t ldb, double* c, size_t ldc) {
+  detail::HasAvx2()
+      ? detail::GemmAvx2<detail::Avx2Double>(n, m, k, a, lda, b, ldb, c, ldc)
+      : detail::GemmVec<detail::Sse2Double>(n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+inline void Gemm(size_t n, size_t m, size_t k, const float* a, size_t lda,
+                 const float* b, size_t ldb, float* c, size_t ldc) {
+  detail::HasAvx2()
+      ? detail::GemmAvx2<detail::Avx2Float>(n, m, k, a, lda, b, ldb, c, ldc)
+      : detail::GemmVec<detail::Sse2Float>(n, m, k, a, lda, b, ldb, c, ldc);
+}
+
+#ifdef __x86_64__
+
+inline double SparseDot(const double* values, const size_t* indices,
+                        const double* x, size_t size) {
+  return detail::HasAvx2() ? detail::SparseDotAvx2(values, indices, x, size)
+                           : SparseDot<double>(values, indices, x, size);
+}
+
+inline float SparseDot(const float* values, const size_t* indices,
+                       const float* x, size_t size) {
+  return detail::HasAvx2() ? detail::SparseDotAvx2(values, indices, x, size)
+                           : SparseDot<float>(values, indices, x, size);
+}
+
+#endif  // #ifdef __x86_64__
+
+#pragma GCC diagnostic pop
+
+#endif  // #ifdef MATRIX_KERNELS_X86
+
+}  // namespace matrix_kernels
+
+#endif  // #ifndef MATRIX_KERNELS
@@ -0,0 +1,51 @@
+#ifndef MATRIX_LAYOUT
+#define MATRIX_LAYOUT
+
+#include <cstddef>
+#include <type_traits>
+
+#include "matrix_kernels.hpp"
+
+struct ColumnMajor {
+  static constexpr size_t Index(size_t row, size_t col, size_t rows,
+                                size_t /*cols*/) {
+    return row + col * rows;
+  }
+};
+
+struct RowMajor {
+  static constexpr size_t Index(size_t row, size_t col, size_t /*rows*/,
+                                size_t cols) {
+    return row * cols + col;
+  }
+};
+
+// c += a * b for densely packed operands stored in Layout. A row-major
+// matrix is the column-major storage of its transpose, so the row-major
+// case computes c^T += b^T * a^T.
+template <typename Layout, typename T>
+constexpr void LayoutGemm(size_t n, size_t m, size_t k, const T* a,
+                          const T* b, T* c) {
+  if constexpr (std::is_same_v<Layout, RowMajor>) {
+    LayoutGemm<ColumnMajor>(k, m, n, b, a, c);
+  } else if (std::is_constant_evaluated()) {
+    matrix_kernels::Gemm<T>(n, m, k, a, n, b, m, c, n);
+  } else {
+    matrix_kernels::Gemm(n, m, k, a, n, b, m, c, n);
+  }
+}
+
+// dst = src^T for a densely packed rows x cols src stored in Layout, with
+// dst in the same layout. Reading the storage of a matrix in the other
+// layout also yields its transpose, so this converts between layouts too.
+template <typename Layout, typename T>
+constexpr void LayoutTranspose(size_t rows, size_t cols, const T* src,
+                               T* dst) {
+  if constexpr (std::is_same_v<Layout, RowMajor>) {
+    LayoutTranspose<ColumnMajor>(cols, rows, src, dst);
+  } else {
+    matrix_kernels::Transpose(rows, cols, src, rows, dst, cols);
+  }
+}
+
+#endif  // #ifndef MATRIX_LAYOUT
@@ -0,0 +1,138 @@
+#ifndef MODULAR
+#define MODULAR
+
+#include <cstddef>
+#include <cstdint>
+
+#include "matrix_kernels.hpp"
+
+// Residue modulo an odd Mod < 2^63, kept in Montgomery form (value * 2^64
+// mod Mod) so that a product costs two multiplications and no division.
+template <uint64_t Mod>
+class Modular {
+  static_assert(Mod % 2 == 1 and Mod < (uint64_t(1) << 63));
+
+ public:
+  __extension__ typedef unsigned __int128 Wide;
+
+  constexpr Modular() = default;
+  constexpr Modular(int64_t value) {
+    int64_t rem = value % static_cast<int64_t>(Mod);
+    value_ = ToMontgomery(rem < 0 ? rem + Mod : rem);
+  }
+
+  constexpr uint64_t Value() const { return Reduce(value_); }
+
+  // Maps the sum of at most kLazyTerms products of Montgomery forms back to
+  // Montgomery form.
+  static constexpr uint64_t Reduce(Wide value) {
+    uint64_t mult = static_cast<uint64_t>(value) * kNegInverse;
+    uint64_t res = static_cast<uint64_t>((value + Wide(mult) * Mod) >> 64);
+    return res >= Mod ? res - Mod : res;
+  }
+  static constexpr Modular FromMontgomery(uint64_t raw) {
+    Modular res;
+    res.value_ = raw;
+    return res;
+  }
+  constexpr uint64_t Montgomery() const { return value_; }
+
+  static constexpr size_t kLazyTerms = static_cast<size_t>(~uint64_t(0) / Mod);
+
+  constexpr Modular& operator+=(const Modular& other) {
+    value_ += other.value_;
+    value_ = value_ >= Mod ? value_ - Mod : value_;
+    return *this;
+  }
+  constexpr Modular& operator-=(const Modular& other) {
+    value_ = value_ >= other.value_ ? value_ - other.value_
+                                    : value_ + Mod - other.value_;
+    return *this;
+  }
+  constexpr Modular& operator*=(const Modular& other) {
+    value_ = Reduce(Wide(value_) * other.value_);
+    return *this;
+  }
+
+  constexpr Modular operator-() const { return Modular() - *this; }
+
+  friend constexpr Modular operator+(Modular lhs, const Modular& rhs) {
+    return lhs += rhs;
+  }
+  friend constexpr Modular operator-(Modular lhs, const Modular& rhs) {
+    return lhs -= rhs;
+  }
+  friend constexpr Modular operator*(Modular lhs, const Modular& rhs) {
+    return lhs *= rhs;
+  }
+  friend constexpr bool operator==(const Modular& lhs, const Modular& rhs) {
+    return lhs.value_ == rhs.value_;
+  }
+  friend constexpr bool operator!=(const Modular& lhs, const Modular& rhs) {
+    return lhs.value_ != rhs.value_;
+  }
+
+ private:
+  static constexpr uint64_t ComputeNegInverse() {
+    uint64_t inverse = Mod;
+    for (int i = 0; i < 6; ++i) {
+      inverse *= 2 - Mod * inverse;
+    }
+    return -inverse;
+  }
+
+  static constexpr uint64_t kNegInverse = ComputeNegInverse();
+  static constexpr uint64_t kR2 = static_cast<uint64_t>(
+      (Wide((Wide(1) << 64) % Mod) * ((Wide(1) << 64) % Mod)) % Mod);
+
+  static constexpr uint64_t ToMontgomery(uint64_t value) {
+    return Reduce(Wide(value) * kR2);
+  }
+
+  uint64_t value_ = 0;
+};
+
+namespace matrix_kernels {
+
+// Sums kLazyTerms 128-bit products per output element before a single
+// Montgomery reduction, instead of reducing after every multiply-add.
+template <uint64_t Mod>
+struct GemmKernel<Modular<Mod>> {
+  static const size_t kBlockRows = 64;
+
+  static constexpr void Run(size_t n, size_t m, size_t k,
+                            const Modular<Mod>* a, size_t lda,
+                            const Modular<Mod>* b, size_t ldb,
+                            Modular<Mod>* c, size_t ldc) {
+    using Wide = typename Modular<Mod>::Wide;
+    const size_t kLazy = Modular<Mod>::kLazyTerms;
+    Wide acc[kBlockRows] = {};
+    for (size_t j = 0; j < k; ++j) {
+      for (size_t i0 = 0; i0 < n; i0 += kBlockRows) {
+        size_t rows = n - i0 < kBlockRows ? n - i0 : kBlockRows;
+        Modular<Mod>* out = c + i0 + j * ldc;
+        for (size_t p0 = 0; p0 < m; p0 += kLazy) {
+          size_t inner = m - p0 < kLazy ? m - p0 : kLazy;
+          for (size_t i = 0; i < rows; ++i) {
+            acc[i] = 0;
+          }
+          for (size_t p = p0; p < p0 + inner; ++p) {
+            uint64_t mult = b[p + j * ldb].Montgomery();
+            const Modular<Mod>* column = a + i0 + p * lda;
+            for (size_t i = 0; i < rows; ++i) {
+              acc[i] += Wide(column[i].Montgomery()) * mult;
+            }
+          }
+          for (size_t i = 0; i < rows; ++i) {
+            out[i] +=
+                Modular<Mod>::FromMontgomery(Modular<Mod>::Reduce(acc[i]));
+          }
+        }
+      }
+    }
+  }
+};
+
+}  // namespace matrix_kernels
+
+#endif  // #ifndef MODULAR
@@ -0,0 +1,73 @@
+#ifndef PARALLEL_MULTIPLY
+#define PARALLEL_MULTIPLY
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../thread_pool/thread_pool.hpp"
+#include "dynamic_matrix.hpp"
+#include "matrix.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// Products with fewer multiply-adds than this stay on the calling thread.
+const size_t kParallelMultiplyThreshold = size_t(1) << 21;
+const size_t kParallelTileRows = 192;
+const size_t kParallelTileCols = 64;
+
+// Column-major c += a * b split into independent tiles of c.
+template <typename T>
+void ParallelGemm(ThreadPool& pool, size_t n, size_t m, size_t k, const T* a,
+                  size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+                  size_t threshold = kParallelMultiplyThreshold) {
+  if (n * m * k < threshold or pool.Size() < 2) {
+    matrix_kernels::Gemm(n, m, k, a, lda, b, ldb, c, ldc);
+    return;
+  }
+  size_t row_tiles = (n + kParallelTileRows - 1) / kParallelTileRows;
+  size_t col_tiles = (k + kParallelTileCols - 1) / kParallelTileCols;
+  pool.ParallelFor(row_tiles * col_tiles, [&](size_t tile) {
+    size_t i0 = tile % row_tiles * kParallelTileRows;
+    size_t j0 = tile / row_tiles * kParallelTileCols;
+    size_t rows = n - i0 < kParallelTileRows ? n - i0 : kParallelTileRows;
+    size_t cols = k - j0 < kParallelTileCols ? k - j0 : kParallelTileCols;
+    matrix_kernels::Gemm(rows, m, cols, a + i0, lda, b + j0 * ldb, ldb,
+                         c + i0 + j0 * ldc, ldc);
+  });
+}
+
+template <typename Layout, typename T>
+void LayoutParallelGemm(ThreadPool& pool, size_t n, size_t m, size_t k,
+                        const T* a, const T* b, T* c, size_t threshold) {
+  if constexpr (std::is_same_v<Layout, RowMajor>) {
+    ParallelGemm(pool, k, m, n, b, k, a, m, c, k, threshold);
+  } else {
+    ParallelGemm(pool, n, m, k, a, n, b, m, c, n, threshold);
+  }
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> ParallelMultiply(
+    const DynamicMatrix<T, L>& lhs, const DynamicMatrix<T, L>& rhs,
+    ThreadPool& pool, size_t threshold = kParallelMultiplyThreshold) {
+  if (lhs.Cols() != rhs.Rows()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  DynamicMatrix<T, L> res(lhs.Rows(), rhs.Cols());
+  LayoutParallelGemm<L>(pool, lhs.Rows(), lhs.Cols(), rhs.Cols(), lhs.Data(),
+                        rhs.Data(), res.Data(), threshold);
+  return res;
+}
+
+template <size_t N, size_t M, size_t K, typename T, typename L>
+Matrix<N, K, T, L> ParallelMultiply(
+    const Matrix<N, M, T, L>& lhs, const Matrix<M, K, T, L>& rhs,
+    ThreadPool& pool, size_t threshold = kParallelMultiplyThreshold) {
+  Matrix<N, K, T, L> res;
+  LayoutParallelGemm<L>(pool, N, M, K, lhs.Data(), rhs.Data(), res.Data(),
+                        threshold);
+  return res;
+}
+
+#endif  // #ifndef PARALLEL_MULTIPLY
@@ -0,0 +1,376 @@
+#ifndef SPARSE_MATRIX
+#define SPARSE_MATRIX
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "../thread_pool/thread_pool.hpp"
+#include "dynamic_matrix.hpp"
+#include "matrix.hpp"
+#include "matrix_expr.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// Products with fewer multiply-adds than this stay on the calling thread.
+const size_t kParallelSparseThreshold = size_t(1) << 16;
+
+template <typename T>
+class SparseMatrixBuilder;
+
+// Compressed sparse storage. L = RowMajor gives CSR: offsets_ has one entry
+// per row plus one, and indices_ holds column numbers sorted within a row.
+// L = ColumnMajor gives CSC with the roles of rows and columns swapped.
+template <typename T = int64_t, typename L = RowMajor>
+class SparseMatrix {
+ public:
+  using ValueType = T;
+  using Layout = L;
+  static constexpr bool kRowMajor = std::is_same_v<L, RowMajor>;
+
+  SparseMatrix() : offsets_(1) {}
+  SparseMatrix(size_t rows, size_t cols)
+      : rows_(rows), cols_(cols), offsets_((kRowMajor ? rows : cols) + 1) {}
+  template <typename E>
+  explicit SparseMatrix(const MatrixExpr<E>& dense);
+
+  size_t Rows() const { return rows_; }
+  size_t Cols() const { return cols_; }
+  size_t NonZeros() const { return values_.size(); }
+
+  // Slot range of row (CSR) or column (CSC) outer is
+  // [Offsets()[outer], Offsets()[outer + 1]).
+  const std::vector<size_t>& Offsets() const { return offsets_; }
+  const std::vector<size_t>& Indices() const { return indices_; }
+  const std::vector<T>& Values() const { return values_; }
+
+  T operator()(size_t row, size_t col) const;
+
+  template <typename DenseLayout = ColumnMajor>
+  DynamicMatrix<T, DenseLayout> ToDense() const;
+  template <size_t N, size_t M, typename DenseLayout = ColumnMajor>
+  Matrix<N, M, T, DenseLayout> ToMatrix() const;
+  template <typename OtherLayout>
+  SparseMatrix<T, OtherLayout> ToLayout() const;
+
+  // y = A x for dense x of Cols() and y of Rows() elements.
+  void Multiply(const T* x, T* y) const;
+  // Column-major c = A b for a dense b with count columns. Only rows in
+  // [row_begin, row_end) of c are written; CSC ignores the range and
+  // writes all of c.
+  void Multiply(size_t count, const T* b, size_t ldb, T* c, size_t ldc,
+                size_t row_begin, size_t row_end) const;
+
+  // Splits the rows into at most parts ranges holding about the same number
+  // of nonzeros. Returns parts + 1 boundaries.
+  std::vector<size_t> BalancedRowSplit(size_t parts) const;
+
+ private:
+  friend class SparseMatrixBuilder<T>;
+
+  size_t Outer() const { return kRowMajor ? rows_ : cols_; }
+
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  std::vector<size_t> offsets_;
+  std::vector<size_t> indices_;
+  std::vector<T> values_;
+};
+
+// Collects (row, col, value) triplets in any order. Build() sorts them with
+// two counting sort passes, O(nnz + rows + cols), and sums duplicates.
+template <typename T = int64_t>
+class SparseMatrixBuilder {
+ public:
+  SparseMatrixBuilder(size_t rows, size_t cols) : rows_(rows), cols_(cols) {}
+
+  void Reserve(size_t size);
+  void Add(size_t row, size_t col, const T& value);
+
+  template <typename L = RowMajor>
+  SparseMatrix<T, L> Build() const;
+
+ private:
+  size_t rows_;
+  size_t cols_;
+  std::vector<size_t> row_indices_;
+  std::vector<size_t> col_indices_;
+  std::vector<T> values_;
+};
+
+template <typename T>
+void SparseMatrixBuilder<T>::Reserve(size_t size) {
+  row_indices_.reserve(size);
+  col_indices_.reserve(size);
+  values_.reserve(size);
+}
+
+template <typename T>
+void SparseMatrixBuilder<T>::Add(size_t row, size_t col, const T& value) {
+  if (row >= rows_ or col >= cols_) {
+    throw std::out_of_range("Sparse matrix entry out of bounds");
+  }
+  row_indices_.push_back(row);
+  col_indices_.push_back(col);
+  values_.push_back(value);
+}
+
+template <typename T>
+template <typename L>
+SparseMatrix<T, L> SparseMatrixBuilder<T>::Build() const {
+  SparseMatrix<T, L> res(rows_, cols_);
+  bool row_major = SparseMatrix<T, L>::kRowMajor;
+  const std::vector<size_t>& outer = row_major ? row_indices_ : col_indices_;
+  const std::vector<size_t>& inner = row_major ? col_indices_ : row_indices_;
+  size_t outer_size = row_major ? rows_ : cols_;
+  size_t inner_size = row_major ? cols_ : rows_;
+  size_t size = values_.size();
+
+  // Least significant key first, so the stable second pass leaves every
+  // outer segment sorted by inner index.
+  std::vector<size_t> by_inner(size);
+  std::vector<size_t> starts(inner_size + 1);
+  for (size_t i = 0; i < size; ++i) {
+    ++starts[inner[i] + 1];
+  }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  for (size_t i = 0; i < size; ++i) {
+    by_inner[starts[inner[i]]++] = i;
+  }
+
+  std::vector<size_t> order(size);
+  starts.assign(outer_size + 1, 0);
+  for (size_t i = 0; i < size; ++i) {
+    ++starts[outer[i] + 1];
+  }
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+  for (size_t i : by_inner) {
+    order[starts[outer[i]]++] = i;
+  }
+
+  res.indices_.reserve(size);
+  res.values_.reserve(size);
+  size_t pos = 0;
+  for (size_t o = 0; o < outer_size; ++o) {
+    for (; pos < size and outer[order[pos]] == o; ++pos) {
+      size_t idx = order[pos];
+      if (res.indices_.size() > res.offsets_[o] and
+          res.indices_.back() == inner[idx]) {
+        res.values_.back() += values_[idx];
+      } else {
+        res.indices_.push_back(inner[idx]);
+        res.values_.push_back(values_[idx]);
+      }
+    }
+    res.offsets_[o + 1] = res.indices_.size();
+  }
+  return res;
+}
+
+template <typename T, typename L>
+template <typename E>
+SparseMatrix<T, L>::SparseMatrix(const MatrixExpr<E>& dense)
+    : SparseMatrix(dense.Self().Rows(), dense.Self().Cols()) {
+  const E& expr = dense.Self();
+  for (size_t o = 0; o < Outer(); ++o) {
+    for (size_t i = 0; i < (kRowMajor ? cols_ : rows_); ++i) {
+      T elem = kRowMajor ? ElementAt(expr, o, i) : ElementAt(expr, i, o);
+      if (elem != T()) {
+        indices_.push_back(i);
+        values_.push_back(elem);
+      }
+    }
+    offsets_[o + 1] = indices_.size();
+  }
+}
+
+template <typename T, typename L>
+T SparseMatrix<T, L>::operator()(size_t row, size_t col) const {
+  size_t o = kRowMajor ? row : col;
+  size_t i = kRowMajor ? col : row;
+  auto begin = indices_.begin() + offsets_[o];
+  auto end = indices_.begin() + offsets_[o + 1];
+  auto it = std::lower_bound(begin, end, i);
+  return it != end and *it == i ? values_[it - indices_.begin()] : T();
+}
+
+template <typename T, typename L>
+template <typename DenseLayout>
+DynamicMatrix<T, DenseLayout> SparseMatrix<T, L>::ToDense() const {
+  DynamicMatrix<T, DenseLayout> res(rows_, cols_);
+  for (size_t o = 0; o < Outer(); ++o) {
+    for (size_t pos = offsets_[o]; pos < offsets_[o + 1]; ++pos) {
+      if constexpr (kRowMajor) {
+        res(o, indices_[pos]) = values_[pos];
+      } else {
+        res(indices_[pos], o) = values_[pos];
+      }
+    }
+  }
+  return res;
+}
+
+template <typename T, typename L>
+template <size_t N, size_t M, typename DenseLayout>
+Matrix<N, M, T, DenseLayout> SparseMatrix<T, L>::ToMatrix() const {
+  if (rows_ != N or cols_ != M) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  Matrix<N, M, T, DenseLayout> res;
+  for (size_t o = 0; o < Outer(); ++o) {
+    for (size_t pos = offsets_[o]; pos < offsets_[o + 1]; ++pos) {
+      if constexpr (kRowMajor) {
+        res(o, indices_[pos]) = values_[pos];
+      } else {
+        res(indices_[pos], o) = values_[pos];
+      }
+    }
+  }
+  return res;
+}
+
+template <typename T, typename L>
+template <typename OtherLayout>
+SparseMatrix<T, OtherLayout> SparseMatrix<T, L>::ToLayout() const {
+  SparseMatrixBuilder<T> builder(rows_, cols_);
+  builder.Reserve(NonZeros());
+  for (size_t o = 0; o < Outer(); ++o) {
+    for (size_t pos = offsets_[o]; pos < offsets_[o + 1]; ++pos) {
+      if constexpr (kRowMajor) {
+        builder.Add(o, indices_[pos], values_[pos]);
+      } else {
+        builder.Add(indices_[pos], o, values_[pos]);
+      }
+    }
+  }
+  return builder.template Build<OtherLayout>();
+}
+
+template <typename T, typename L>
+void SparseMatrix<T, L>::Multiply(const T* x, T* y) const {
+  Multiply(1, x, cols_, y, rows_, 0, rows_);
+}
+
+template <typename T, typename L>
+void SparseMatrix<T, L>::Multiply(size_t count, const T* b, size_t ldb, T* c,
+                                  size_t ldc, size_t row_begin,
+                                  size_t row_end) const {
+  if constexpr (kRowMajor) {
+    // The index stream of a row is reused for every column of b.
+    for (size_t row = row_begin; row < row_end; ++row) {
+      size_t begin = offsets_[row];
+      size_t size = offsets_[row + 1] - begin;
+      for (size_t j = 0; j < count; ++j) {
+        c[row + j * ldc] = matrix_kernels::SparseDot(
+            values_.data() + begin, indices_.data() + begin, b + j * ldb,
+            size);
+      }
+    }
+  } else {
+    for (size_t j = 0; j < count; ++j) {
+      T* out = c + j * ldc;
+      std::fill(out, out + rows_, T());
+      for (size_t col = 0; col < cols_; ++col) {
+        T mult = b[col + j * ldb];
+        for (size_t pos = offsets_[col]; pos < offsets_[col + 1]; ++pos) {
+          out[indices_[pos]] += values_[pos] * mult;
+        }
+      }
+    }
+  }
+}
+
+template <typename T, typename L>
+std::vector<size_t> SparseMatrix<T, L>::BalancedRowSplit(size_t parts) const {
+  std::vector<size_t> bounds(1, 0);
+  for (size_t part = 1; part < parts; ++part) {
+    size_t target = NonZeros() * part / parts;
+    size_t row = std::lower_bound(offsets_.begin(), offsets_.end(), target) -
+                 offsets_.begin();
+    if (row > bounds.back() and row < rows_) {
+      bounds.push_back(row);
+    }
+  }
+  bounds.push_back(rows_);
+  return bounds;
+}
+
+namespace sparse_detail {
+
+// Product with a dense operand already stored column-major; CSR rows are
+// split across the pool when there is enough work.
+template <typename T, typename L>
+void Multiply(const SparseMatrix<T, L>& lhs, size_t count, const T* b,
+              T* c, ThreadPool* pool) {
+  if (not SparseMatrix<T, L>::kRowMajor or pool == nullptr or
+      pool->Size() < 2 or lhs.NonZeros() * count < kParallelSparseThreshold) {
+    lhs.Multiply(count, b, lhs.Cols(), c, lhs.Rows(), 0, lhs.Rows());
+    return;
+  }
+  std::vector<size_t> bounds =
+      lhs.BalancedRowSplit(pool->Size() * kThreadPoolTasksPerThread);
+  pool->ParallelFor(bounds.size() - 1, [&](size_t part) {
+    lhs.Multiply(count, b, lhs.Cols(), c, lhs.Rows(), bounds[part],
+                 bounds[part + 1]);
+  });
+}
+
+template <typename T, typename L, typename E>
+DynamicMatrix<T> Multiply(const SparseMatrix<T, L>& lhs,
+                          const MatrixExpr<E>& rhs_expr, ThreadPool* pool) {
+  const E& rhs = rhs_expr.Self();
+  if (lhs.Cols() != rhs.Rows()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  DynamicMatrix<T> res(lhs.Rows(), rhs.Cols());
+  if constexpr (E::kIsLeaf and std::is_same_v<typename E::Layout,
+                                              ColumnMajor>) {
+    Multiply(lhs, rhs.Cols(), rhs.Data(), res.Data(), pool);
+  } else {
+    DynamicMatrix<T> dense = rhs;
+    Multiply(lhs, dense.Cols(), dense.Data(), res.Data(), pool);
+  }
+  return res;
+}
+
+}  // namespace sparse_detail
+
+template <typename T, typename L, typename E>
+DynamicMatrix<T> operator*(const SparseMatrix<T, L>& lhs,
+                           const MatrixExpr<E>& rhs) {
+  return sparse_detail::Multiply(lhs, rhs, nullptr);
+}
+
+template <typename T, typename L>
+std::vector<T> operator*(const SparseMatrix<T, L>& lhs,
+                         const std::vector<T>& rhs) {
+  if (lhs.Cols() != rhs.size()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  std::vector<T> res(lhs.Rows());
+  sparse_detail::Multiply(lhs, 1, rhs.data(), res.data(), nullptr);
+  return res;
+}
+
+template <typename T, typename L, typename E>
+DynamicMatrix<T> ParallelMultiply(const SparseMatrix<T, L>& lhs,
+                                  const MatrixExpr<E>& rhs, ThreadPool& pool) {
+  return sparse_detail::Multiply(lhs, rhs, &pool);
+}
+
+template <typename T, typename L>
+std::vector<T> ParallelMultiply(const SparseMatrix<T, L>& lhs,
+                                const std::vector<T>& rhs, ThreadPool& pool) {
+  if (lhs.Cols() != rhs.size()) {
+    throw std::invalid_argument("Matrix shapes do not match");
+  }
+  std::vector<T> res(lhs.Rows());
+  sparse_detail::Multiply(lhs, 1, rhs.data(), res.data(), &pool);
+  return res;
+}
+
+#endif  // #ifndef SPARSE_MATRIX
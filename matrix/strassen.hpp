@@ -0,0 +1,179 @@
+#ifndef STRASSEN
+#define STRASSEN
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "aligned_buffer.hpp"
+#include "dynamic_matrix.hpp"
+#include "matrix.hpp"
+#include "matrix_kernels.hpp"
+#include "matrix_layout.hpp"
+
+// Strassen-Winograd multiplication of square matrices: 7 recursive products
+// and 15 additions per level, down to a cutoff where the regular Gemm
+// kernel takes over. Odd sizes are handled by peeling the last row and
+// column off and fixing them up with thin Gemm calls.
+//
+// Only ring operations are used, so integer results are exact (as exact as
+// the regular product under the same wrap-around). For floating point,
+// with n0 the size at which recursion stops and u the unit roundoff,
+//   max|C - C'| <= [(n / n0)^log2(18) * (n0^2 + 6 n0) - 6 n] u
+//                  * max|A| * max|B| + O(u^2)
+// (Higham, Accuracy and Stability of Numerical Algorithms, 23.2.3). This is
+// a norm-wise bound: small entries of C can lose more relative accuracy
+// than with the classical product.
+
+const size_t kStrassenCutoff = 128;
+
+namespace strassen_detail {
+
+template <typename T>
+void BlockAdd(size_t n, const T* x, size_t ldx, const T* y, size_t ldy, T* z,
+              size_t ldz) {
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      z[i + j * ldz] = x[i + j * ldx] + y[i + j * ldy];
+    }
+  }
+}
+
+template <typename T>
+void BlockSub(size_t n, const T* x, size_t ldx, const T* y, size_t ldy, T* z,
+              size_t ldz) {
+  for (size_t j = 0; j < n; ++j) {
+    for (size_t i = 0; i < n; ++i) {
+      z[i + j * ldz] = x[i + j * ldx] - y[i + j * ldy];
+    }
+  }
+}
+
+template <typename T>
+void BlockZero(size_t rows, size_t cols, T* z, size_t ldz) {
+  for (size_t j = 0; j < cols; ++j) {
+    for (size_t i = 0; i < rows; ++i) {
+      z[i + j * ldz] = T();
+    }
+  }
+}
+
+inline size_t ScratchSize(size_t n, size_t cutoff) {
+  size_t size = 0;
+  for (; n > cutoff; n /= 2) {
+    size += 2 * (n / 2) * (n / 2);
+  }
+  return size;
+}
+
+// Column-major c = a * b for n x n operands. Every level keeps its two
+// temporaries at the front of scratch and hands the rest to the level below.
+template <typename T>
+void Multiply(size_t n, const T* a, size_t lda, const T* b, size_t ldb, T* c,
+              size_t ldc, T* scratch, size_t cutoff) {
+  if (n <= cutoff) {
+    BlockZero(n, n, c, ldc);
+    matrix_kernels::Gemm(n, n, n, a, lda, b, ldb, c, ldc);
+    return;
+  }
+
+  size_t h = n / 2;
+  const T* a11 = a;
+  const T* a21 = a + h;
+  const T* a12 = a + h * lda;
+  const T* a22 = a + h + h * lda;
+  const T* b11 = b;
+  const T* b21 = b + h;
+  const T* b12 = b + h * ldb;
+  const T* b22 = b + h + h * ldb;
+  T* c11 = c;
+  T* c21 = c + h;
+  T* c12 = c + h * ldc;
+  T* c22 = c + h + h * ldc;
+  T* x = scratch;
+  T* y = scratch + h * h;
+  T* next = scratch + 2 * h * h;
+
+  // Schedule with two temporaries from Boyer, Dumas, Pernet and Zhou,
+  // "Memory efficient scheduling of Strassen-Winograd's matrix
+  // multiplication algorithm".
+  BlockSub(h, a11, lda, a21, lda, x, h);
+  BlockSub(h, b22, ldb, b12, ldb, y, h);
+  Multiply(h, x, h, y, h, c21, ldc, next, cutoff);
+  BlockAdd(h, a21, lda, a22, lda, x, h);
+  BlockSub(h, b12, ldb, b11, ldb, y, h);
+  Multiply(h, x, h, y, h, c22, ldc, next, cutoff);
+  BlockSub(h, x, h, a11, lda, x, h);
+  BlockSub(h, b22, ldb, y, h, y, h);
+  Multiply(h, x, h, y, h, c12, ldc, next, cutoff);
+  BlockSub(h, a12, lda, x, h, x, h);
+  Multiply(h, x, h, b22, ldb, c11, ldc, next, cutoff);
+  Multiply(h, a11, lda, b11, ldb, x, h, next, cutoff);
+  BlockAdd(h, x, h, c12, ldc, c12, ldc);
+  BlockAdd(h, c12, ldc, c21, ldc, c21, ldc);
+  BlockAdd(h, c12, ldc, c22, ldc, c12, ldc);
+  BlockAdd(h, c21, ldc, c22, ldc, c22, ldc);
+  BlockAdd(h, c12, ldc, c11, ldc, c12, ldc);
+  BlockSub(h, y, h, b21, ldb, y, h);
+  Multiply(h, a22, lda, y, h, c11, ldc, next, cutoff);
+  BlockSub(h, c21, ldc, c11, ldc, c21, ldc);
+  Multiply(h, a12, lda, b21, ldb, c11, ldc, next, cutoff);
+  BlockAdd(h, x, h, c11, ldc, c11, ldc);
+
+  if (n % 2 == 0) {
+    return;
+  }
+  size_t e = n - 1;
+  matrix_kernels::Gemm(e, 1, e, a + e * lda, lda, b + e, ldb, c, ldc);
+  BlockZero(n, 1, c + e * ldc, ldc);
+  matrix_kernels::Gemm(n, n, 1, a, lda, b + e * ldb, ldb, c + e * ldc, ldc);
+  BlockZero(1, e, c + e, ldc);
+  matrix_kernels::Gemm(1, n, e, a + e, lda, b, ldb, c + e, ldc);
+}
+
+}  // namespace strassen_detail
+
+// Column-major c = a * b for n x n operands. The scratch arena for the whole
+// recursion is allocated once, up front.
+template <typename T>
+void StrassenGemm(size_t n, const T* a, size_t lda, const T* b, size_t ldb,
+                  T* c, size_t ldc, size_t cutoff = kStrassenCutoff) {
+  cutoff = cutoff < 1 ? 1 : cutoff;
+  AlignedBuffer<T> scratch(strassen_detail::ScratchSize(n, cutoff));
+  strassen_detail::Multiply(n, a, lda, b, ldb, c, ldc, scratch.Data(),
+                            cutoff);
+}
+
+template <typename Layout, typename T>
+void LayoutStrassenGemm(size_t n, const T* a, const T* b, T* c,
+                        size_t cutoff) {
+  if constexpr (std::is_same_v<Layout, RowMajor>) {
+    StrassenGemm(n, b, n, a, n, c, n, cutoff);
+  } else {
+    StrassenGemm(n, a, n, b, n, c, n, cutoff);
+  }
+}
+
+template <typename T, typename L>
+DynamicMatrix<T, L> StrassenMultiply(const DynamicMatrix<T, L>& lhs,
+                                     const DynamicMatrix<T, L>& rhs,
+                                     size_t cutoff = kStrassenCutoff) {
+  size_t n = lhs.Rows();
+  if (lhs.Cols() != n or rhs.Rows() != n or rhs.Cols() != n) {
+    throw std::invalid_argument("Strassen needs square matrices of one size");
+  }
+  DynamicMatrix<T, L> res(n, n);
+  LayoutStrassenGemm<L>(n, lhs.Data(), rhs.Data(), res.Data(), cutoff);
+  return res;
+}
+
+template <size_t N, typename T, typename L>
+Matrix<N, N, T, L> StrassenMultiply(const Matrix<N, N, T, L>& lhs,
+                                    const Matrix<N, N, T, L>& rhs,
+                                    size_t cutoff = kStrassenCutoff) {
+  Matrix<N, N, T, L> res;
+  LayoutStrassenGemm<L>(N, lhs.Data(), rhs.Data(), res.Data(), cutoff);
+  return res;
+}
+
+#endif  // #ifndef STRASSEN
@@ -0,0 +1,217 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Parts per worker to split uneven work into, so that stealing can even
+// out what a split up front did not predict.
+const size_t kThreadPoolTasksPerThread = 4;
+
+struct ThreadPoolOptions {
+  size_t threads = std::thread::hardware_concurrency();
+  // Worker i is pinned to cpus[i % cpus.size()]; empty means no pinning.
+  std::vector<int> cpus;
+};
+
+// Every worker owns a deque: it pops its own tasks from the back and steals
+// from the front of the others when it runs dry.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  ThreadPool() : ThreadPool(ThreadPoolOptions()) {}
+  explicit ThreadPool(const ThreadPoolOptions& options);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ~ThreadPool();
+
+  size_t Size() const { return threads_.size(); }
+
+  void Submit(Task task);
+
+  // Runs func(0), ..., func(count - 1) on the pool and returns when all of
+  // them are done. The calling thread executes tasks while there are any
+  // to steal and then sleeps. If any call throws, the rest still run and
+  // the first exception is rethrown at the end. If Submit throws, the
+  // calls already submitted finish before its exception propagates.
+  template <typename F>
+  void ParallelFor(size_t count, F&& func);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Run(size_t index);
+  bool TryPop(size_t index, Task& task);
+  bool TrySteal(size_t index, Task& task);
+  void Pin(std::thread& thread, int cpu);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_ = 0;
+  std::atomic<size_t> pending_ = 0;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+};
+
+inline ThreadPool::ThreadPool(const ThreadPoolOptions& options) {
+  size_t threads = options.threads == 0 ? 1 : options.threads;
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this, i] { Run(i); });
+    if (not options.cpus.empty()) {
+      Pin(threads_.back(), options.cpus[i % options.cpus.size()]);
+    }
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+inline void ThreadPool::Submit(Task task) {
+  size_t index = next_queue_.fetch_add(1) % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    pending_.fetch_add(1);
+  }
+  try {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  } catch (...) {
+    pending_.fetch_sub(1);
+    throw;
+  }
+  wake_.notify_one();
+}
+
+template <typename F>
+void ThreadPool::ParallelFor(size_t count, F&& func) {
+  std::mutex mutex;
+  std::condition_variable done;
+  size_t remaining = count;
+  std::exception_ptr error;
+  auto task = [&func, &mutex, &done, &remaining, &error](size_t i) {
+    std::exception_ptr task_error;
+    try {
+      func(i);
+    } catch (...) {
+      task_error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error == nullptr) {
+      error = task_error;
+    }
+    // Notifying under the lock keeps done alive until the call returns.
+    if (--remaining == 0) {
+      done.notify_all();
+    }
+  };
+  // Tasks refer to this frame, so it may not be left before all submitted
+  // ones are done. Once nothing is left to steal, they are all running.
+  auto wait = [this, &mutex, &done, &remaining] {
+    Task stolen;
+    while (TrySteal(queues_.size(), stolen)) {
+      stolen();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&remaining] { return remaining == 0; });
+  };
+
+  size_t submitted = 0;
+  try {
+    for (; submitted < count; ++submitted) {
+      Submit([&task, submitted] { task(submitted); });
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      remaining -= count - submitted;
+    }
+    wait();
+    throw;
+  }
+  wait();
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+inline void ThreadPool::Run(size_t index) {
+  Task task;
+  while (true) {
+    if (TryPop(index, task) or TrySteal(index, task)) {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] { return stop_ or pending_.load() != 0; });
+    if (stop_ and pending_.load() == 0) {
+      return;
+    }
+  }
+}
+
+inline bool ThreadPool::TryPop(size_t index, Task& task) {
+  Queue& queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  pending_.fetch_sub(1);
+  return true;
+}
+
+inline bool ThreadPool::TrySteal(size_t index, Task& task) {
+  for (size_t shift = 1; shift <= queues_.size(); ++shift) {
+    Queue& queue = *queues_[(index + shift) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (not queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      pending_.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+inline void ThreadPool::Pin([[maybe_unused]] std::thread& thread,
+                            [[maybe_unused]] int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+}
+
+#endif  // #ifndef THREAD_POOL